@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// Per-cycle arena for short-lived parse data
+// Everything allocated while parsing a source (headers, HTML rows, regex matches and the
+// strings extracted from them) is carved out of a monotonic buffer and released in one shot
+// when the source's cycle ends. Long-lived Event storage must never use the arena.
+namespace Arena {
+
+template<typename T>
+using Allocator = std::pmr::polymorphic_allocator<T>;
+
+// Memory resource for the current thread's active cycle, or the default heap outside of one
+std::pmr::memory_resource* resource();
+
+// Copy text into a string backed by the active arena
+inline std::pmr::string copy(std::string_view text) { return std::pmr::string(text, resource()); }
+
+// Upstream resource which records how much memory the arena requested
+class CountingResource : public std::pmr::memory_resource {
+private:
+  std::pmr::memory_resource* upstream;
+  std::size_t allocated{ 0 };
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+public:
+  explicit CountingResource(std::pmr::memory_resource* source = std::pmr::new_delete_resource()) : upstream{ source } {}
+  std::size_t total() const { return allocated; }
+};
+
+// RAII scope for a single source's parse cycle
+// Installs an arena as the thread's current resource and frees it on destruction
+// sizeHint carries the arena size between cycles so steady state needs a single upstream allocation
+class Cycle {
+private:
+  CountingResource counter;
+  std::pmr::monotonic_buffer_resource buffer;
+  std::pmr::memory_resource* previous;
+  std::size_t& sizeHint;
+public:
+  explicit Cycle(std::size_t& hint);
+  ~Cycle();
+
+  // Bytes reserved from the heap so far
+  std::size_t reserved() const { return counter.total(); }
+
+  // Delete the copy constructor and assignment operator
+  Cycle(const Cycle&) = delete;
+  Cycle& operator=(const Cycle&) = delete;
+};
+
+} // namespace Arena
+
+#endif
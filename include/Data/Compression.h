@@ -0,0 +1,37 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Content-Encoding support for API responses
+// gzip is always available through zlib, brotli only when built with TRAFFIC_HAVE_BROTLI
+namespace Compression {
+
+enum class Encoding : std::uint8_t {
+  Identity,
+  Gzip,
+  Brotli
+};
+
+// Number of encodings, used to size per-encoding tables
+constexpr std::size_t ENCODING_COUNT{ static_cast<std::size_t>(Encoding::Brotli) + 1 };
+// Bodies smaller than this are sent as they are, the headers would outweigh the saving
+constexpr std::size_t COMPRESSION_MIN_BYTES{ 1024 };
+// Compression levels, favouring ratio since cached bodies are compressed once per store version
+constexpr int GZIP_LEVEL{ 6 };
+constexpr int BROTLI_QUALITY{ 6 };
+
+// Token used in the Content-Encoding header (empty for identity)
+std::string_view toString(Encoding encoding);
+// Pick the best supported encoding allowed by an Accept-Encoding header
+Encoding negotiate(const std::string& acceptEncoding);
+// Compress a body, nullopt if it is too small to be worth it or compression failed
+std::optional<std::string> compress(std::string_view data, Encoding encoding);
+
+} // namespace Compression
+
+#endif
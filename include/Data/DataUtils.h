@@ -5,17 +5,24 @@
 #include <json/json.h>
 #include <rapidxml.hpp>
 #include <gumbo.h>
+#include "Arena.h"
 #include <string>
+#include <string_view>
+#include <memory_resource>
 #include <vector>
 #include <memory>
 #include <optional>
 #include <tuple>
 #include <chrono>
 #include <ctime>
+#include <cstdint>
+#include <functional>
+#include <ostream>
 
 // This file holds all functionality for retrieving and filtering basic data from CURL in XML and JSON formats
 void trim(std::string& str);
-std::string sanitizeString(const std::string& input);
+void trim(std::pmr::string& str);
+std::string sanitizeString(std::string_view input);
 std::string convertEncoding(const std::string& input, const char* from_encoding, const char* to_encoding);
 
 namespace cURL {
@@ -29,6 +36,9 @@ enum class Result {
   REQUEST_FAILED
 };
 
+// Response headers, allocated from the current parse arena
+using Headers = std::pmr::vector<std::pmr::string>;
+
 // Create a handler for CURL* objects to maintain RAII
 class Handle {
 private:
@@ -49,40 +59,152 @@ public:
 size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata);
 // Callback function for writing the result data
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* output);
+// Callback function for passing result data to a chunk handler
+size_t StreamCallback(void* contents, size_t size, size_t nmemb, void* userdata);
 // Fetch and process data from remote url (Result, Data, Headers)
-std::tuple<Result, std::string, std::vector<std::string>> getData(const std::string& url, Handle& curl);
+std::tuple<Result, std::string, Headers> getData(const std::string& url, Handle& curl);
 // POST data to a remote endpoint (Result, Data, Headers)
-std::tuple<Result, std::string, std::vector<std::string>> postData(const std::string& url, const std::string& postData, Handle& curl);
+std::tuple<Result, std::string, Headers> postData(const std::string& url, const std::string& postData, Handle& curl);
 // Extract the content type from the response headers
-std::string getContentType(const std::vector<std::string>& headers);
+std::string getContentType(const Headers& headers);
+// Fetch from a remote url, handing each received chunk to a callback instead of buffering the body
+Result streamData(const std::string& url, Handle& curl, const std::function<void(std::string_view)>& onChunk);
 
 } // namespace cURL
 
 namespace JSON {
 Json::Value parseData(const std::string& jsonData);
+
+// Incrementally split a top-level JSON array into its elements
+// Input can be fed in chunks of any size, only the element currently being read is buffered
+class ArraySplitter {
+private:
+  std::string element;      // Text of the element being read
+  int depth{ 0 };           // Nesting depth, the top-level array is depth 1
+  bool inString{ false };
+  bool escaped{ false };
+  bool isArray{ false };    // Whether the top-level value opened with '['
+  bool closed{ false };     // Whether the top-level value has been closed
+public:
+  // Feed the next chunk, calling onElement with the text of each completed object or array element
+  // Scalar elements of the top-level array are skipped, as is everything inside a top-level object
+  void feed(std::string_view chunk, const std::function<void(std::string_view)>& onElement);
+  // Whether a whole top-level array was read, false for a truncated body or an error object
+  bool complete() const { return isArray && closed; }
+};
+
+// Buffered output is handed to the stream once it reaches this size
+constexpr std::size_t WRITER_FLUSH_BYTES{ 16 * 1024 };
+
+// Minified JSON writer for API responses
+// Writes into its own buffer, or through it to an output stream in WRITER_FLUSH_BYTES pieces so memory
+// stays bounded however large the document is. Numbers are formatted with std::to_chars (6 significant
+// digits, independent of the locale) and strings are escaped as UTF-8 with invalid bytes replaced.
+class Writer {
+private:
+  std::string buffer;
+  std::ostream* sink{ nullptr };
+  std::vector<bool> hasItems;     // Whether each open container needs a comma before its next value
+  bool afterKey{ false };
+
+  void separate();
+  void escape(std::string_view text);
+  void flushIfFull() { if(sink && buffer.size() >= WRITER_FLUSH_BYTES) flush(); }
+public:
+  // Constructors
+  Writer() = default;
+  explicit Writer(std::ostream& output) : sink(&output) {}
+
+  // Containers
+  Writer& beginObject();
+  Writer& endObject();
+  Writer& beginArray();
+  Writer& endArray();
+  Writer& key(std::string_view name);
+
+  // Values
+  Writer& value(std::string_view text);
+  Writer& value(const char* text) { return value(std::string_view(text)); }
+  Writer& value(double number);
+  Writer& value(std::int64_t number);
+  Writer& value(std::uint64_t number);
+  Writer& value(bool flag);
+  Writer& null();
+  // Write a string, or null when it is empty
+  Writer& nullable(std::string_view text) { return text.empty() ? null() : value(text); }
+  // Write an already serialized value
+  Writer& raw(std::string_view json);
+
+  // Hand buffered output to the stream
+  void flush();
+  // Accessors for buffered output
+  void reserve(std::size_t size) { buffer.reserve(size); }
+  std::string release() { return std::move(buffer); }
+};
 } // namespace JSON
 
+namespace MsgPack {
+
+// Compact binary writer for API responses in MessagePack
+// Unlike JSON, containers are prefixed with their element count, so callers count the entries of a
+// map or array before writing it and then write exactly that many (a map entry is a key and a value).
+// Integers take the smallest encoding that holds them, strings are UTF-8 with invalid bytes replaced.
+class Writer {
+private:
+  std::string buffer;
+
+  // Append a type byte followed by the low bytes of a value, most significant first
+  void header(unsigned char type, std::uint64_t value, int bytes);
+  // Type byte for a length in the 8, 16 or 32 bit form, fixed forms are handled by callers
+  void length(std::size_t size, unsigned char type8, unsigned char type16, unsigned char type32);
+public:
+  // Containers
+  Writer& map(std::size_t entries);
+  Writer& array(std::size_t items);
+  Writer& key(std::string_view name) { return value(name); }
+
+  // Values
+  Writer& value(std::string_view text);
+  Writer& value(const char* text) { return value(std::string_view(text)); }
+  Writer& value(double number);
+  Writer& value(std::int64_t number);
+  Writer& value(std::uint64_t number);
+  Writer& value(bool flag);
+  Writer& null();
+  // Write a string, or nil when it is empty
+  Writer& nullable(std::string_view text) { return text.empty() ? null() : value(text); }
+
+  // Accessors for buffered output
+  void reserve(std::size_t size) { buffer.reserve(size); }
+  std::string release() { return std::move(buffer); }
+};
+} // namespace MsgPack
+
 namespace XML {
 std::unique_ptr<rapidxml::xml_document<>> parseData(std::string& xmlData);
 } // namespace XML
 
 namespace HTML {
 
+// Intermediate row parsed from an HTML table
+// Strings are allocated from the current parse arena, move rather than copy to keep them there
 struct Event {
-  std::string ID{""};
-  std::string agency{""};
-  std::string date{""};
-  std::string title{""};
-  std::string address{""};
-  std::string direction{""};
-  std::string details{""};
-  std::string region{""};
-  std::string xstreet{""};
-  std::string xstreet1{""};
-  std::string xstreet2{""};
+  std::pmr::string ID{ Arena::resource() };
+  std::pmr::string agency{ Arena::resource() };
+  std::pmr::string date{ Arena::resource() };
+  std::pmr::string title{ Arena::resource() };
+  std::pmr::string address{ Arena::resource() };
+  std::pmr::string direction{ Arena::resource() };
+  std::pmr::string details{ Arena::resource() };
+  std::pmr::string region{ Arena::resource() };
+  std::pmr::string xstreet{ Arena::resource() };
+  std::pmr::string xstreet1{ Arena::resource() };
+  std::pmr::string xstreet2{ Arena::resource() };
   void createID();
 };
 
+using EventList = std::pmr::vector<Event>;
+
 // Create a wrapper for GumboOutput objects to maintain RAII
 class GumboOutputWrapper {
 private:
@@ -126,6 +248,11 @@ struct BoundingBox {
   bool contains(const Location& coordinate) const;
 };
 
+// Great-circle distance between two locations in kilometres
+double distanceKm(const Location& from, const Location& to);
+// Smallest bounding box enclosing a radius (km) around a point
+BoundingBox boundingBox(const Location& center, double radiusKm);
+
 } // namespace Traffic
 
 namespace Time {
@@ -134,6 +261,10 @@ using namespace std::chrono;
 system_clock::time_point currentTime();
 std::time_t currentTime_t();
 
+// Convert between time points and fixed-width seconds since the UNIX epoch
+std::int64_t toEpoch(const system_clock::time_point& time);
+system_clock::time_point fromEpoch(std::int64_t sinceEpoch);
+
 // Create a local formatted time string for printing from a time point object
 std::tm toLocalPrint(const system_clock::time_point& time);
 
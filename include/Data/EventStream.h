@@ -0,0 +1,144 @@
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+
+#include "Traffic.h"
+#include "EventStore.h"
+#include "SubscriptionIndex.h"
+#include <Poco/Net/PollSet.h>
+#include <Poco/Net/Socket.h>
+#include <Poco/Net/StreamSocket.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RestAPI {
+
+// Unsent bytes allowed per client before it is dropped, a client that far behind should reconnect and resume
+constexpr std::size_t STREAM_BUFFER_LIMIT{ 8 * 1024 * 1024 };
+// Keepalives sent to idle clients so proxies keep the connection open and dead peers are noticed
+constexpr std::chrono::seconds STREAM_HEARTBEAT_INTERVAL{ 15 };
+// Largest WebSocket message accepted from a client, subscription requests are tiny
+constexpr std::size_t WEBSOCKET_MESSAGE_LIMIT{ 4096 };
+// How long the reader thread waits for client messages before checking for shutdown
+constexpr std::chrono::milliseconds WEBSOCKET_POLL_INTERVAL{ 250 };
+
+enum class StreamProtocol : std::uint8_t {
+  ServerSentEvents,
+  WebSocket
+};
+
+// Parse region, source and bbox filters, nullopt if a parameter is unknown or malformed
+std::optional<Subscription> parseSubscription(const std::vector<std::pair<std::string, std::string>>& params);
+
+// Live event fan-out for /events/stream (Server-Sent Events) and /events/socket (WebSocket)
+// A request handler writes the response headers, then hands the detached socket to the stream and
+// returns, so an idle client holds no server thread. Once per ingestion cycle the changes are read
+// from the store's change log, each change is serialized once, and the subscription index finds the
+// clients it concerns. A writer thread drains the queues with non-blocking sends and a reader thread
+// takes subscription changes from WebSocket clients.
+class EventStream {
+private:
+  struct Client {
+    Poco::Net::StreamSocket socket;
+    StreamProtocol protocol;
+    Subscription subscription;
+    std::uint64_t from{ 0 };            // Changes up to this sequence were in the client's snapshot
+    std::uint64_t visited{ 0 };         // Last change the client was considered for
+    std::string pending;                // Bytes the socket has not accepted yet
+    std::string received;               // Incomplete WebSocket frames from the client
+    std::string batch;                  // Changes collected for the client's next WebSocket message
+    bool closing{ false };              // Drop once the pending bytes are sent
+  };
+
+  // Position of a streamed event, used to tell clients it left their filters
+  struct Placement {
+    Traffic::Region region;
+    std::optional<Traffic::Location> location;
+  };
+
+  // Lock order is eventsMutex, then clientsMutex
+  std::mutex clientsMutex;
+  std::condition_variable wakeup;
+  std::vector<std::unique_ptr<Client>> clients;
+  SubscriptionIndex<Client*> index;
+  std::vector<Client*> fresh;                             // (Re)subscribed since the last publish
+  std::map<Poco::Net::Socket, Client*> readers;           // WebSocket clients by socket
+  Poco::Net::PollSet pollSet;                             // WebSocket clients not yet closing
+  bool stopping{ false };
+  std::thread writer;
+  std::thread reader;
+
+  // Only used by the ingestion thread, with eventsMutex held
+  std::uint64_t streamedSequence{ 0 };
+  std::unordered_map<Traffic::EventKey, Placement, Traffic::EventKeyHash> placements;   // Last streamed position of each event
+
+  // A change serialized once for every client, defined with the stream
+  struct Outgoing;
+
+  static Placement placementOf(const Traffic::Event& event);
+  static Outgoing makeOutgoing(const Traffic::EventStore& store, const Traffic::Change& change, std::optional<Placement> previous);
+  // Queue a change for a client it concerns, as an update while the event matches its filters and as a delete once it doesn't
+  // Returns whether the change started the client's next WebSocket message
+  static bool queueChange(Client& client, const Outgoing& change);
+  // Build the message replacing a client's view with the events matching its filters
+  static std::string snapshotMessage(const Traffic::EventStore& store, const Client& client);
+  // Wrap a client's collected changes into one WebSocket message
+  static void finishBatch(Client& client, std::uint64_t sequence);
+  // Stop reading from a WebSocket client and stop queueing changes for it
+  void stopReading(Client& client);
+  // Queue a close frame, the client is dropped once it has been sent
+  void closeClient(Client& client, std::uint16_t status);
+  // Forget a client everywhere it is registered, NOTE: clientsMutex must be held
+  void release(Client& client);
+  // Read a WebSocket client's frames, collecting subscription requests
+  void receive(Client& client, std::vector<std::pair<Poco::Net::Socket, Subscription>>& requests);
+  // Replace a WebSocket client's filters and send it a fresh snapshot
+  // NOTE: Must be called without eventsMutex held
+  void resubscribe(const Poco::Net::Socket& socket, const Subscription& subscription);
+  // Send as much of each client's queue as its socket accepts, dropping closed or overflowing clients
+  // Returns whether any client still has data queued
+  bool flush();
+  void writeLoop();
+  void readLoop();
+
+public:
+  EventStream() = default;
+  ~EventStream();
+
+  // Start and stop the writer and reader threads, stopping closes every connection
+  void start();
+  void stop();
+
+  // Take over a client's socket, queuing the events matching its filters
+  // When the client resumes from a sequence still held in the change log only the changes since then are sent
+  // NOTE: Must be called without eventsMutex held
+  void subscribe(Poco::Net::StreamSocket&& socket, StreamProtocol protocol, const Subscription& subscription,
+                 std::optional<std::uint64_t> lastSequence);
+  // Queue the store's changes since the last call for every matching client
+  // NOTE: Must be called without eventsMutex held
+  void publish(const Traffic::EventStore& store);
+
+  std::size_t size();
+
+  // Delete the copy constructor and assignment operator
+  EventStream(const EventStream&) = delete;
+  EventStream& operator=(const EventStream&) = delete;
+};
+
+// Define extern event stream
+extern EventStream eventStream;
+
+} // namespace RestAPI
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include "Compression.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RestAPI {
+
+// Most distinct queries held at once, arbitrary bounding boxes would otherwise grow the cache without limit
+constexpr std::size_t RESPONSE_CACHE_CAPACITY{ 256 };
+
+// Serialized response bodies for the current version of the event store
+// Entries are keyed by the normalized request (path and sorted query parameters) and the whole
+// cache is dropped as soon as a newer store version is seen, so between ingestion cycles repeated
+// requests are answered without touching the store or the JSON serializer.
+// Each entry holds a variant per negotiated encoding, so a body is compressed once per version.
+// Bodies are shared so readers never copy them while holding the lock.
+class ResponseCache {
+public:
+  using Body = std::shared_ptr<const std::string>;
+
+  // A response body and the encoding actually applied to it
+  // Small bodies are stored uncompressed in every variant
+  struct Response {
+    Body body;
+    Compression::Encoding encoding{ Compression::Encoding::Identity };
+  };
+
+private:
+  using Variants = std::array<Response, Compression::ENCODING_COUNT>;   // Indexed by negotiated encoding
+
+  mutable std::shared_mutex mutex;
+  std::uint64_t version{ 0 };                       // Store version the entries were built from
+  std::unordered_map<std::string, Variants> entries;
+
+public:
+  // Build a key which is the same for any ordering of the query parameters
+  static std::string makeKey(const std::string& path, std::vector<std::pair<std::string, std::string>> queryParams);
+  // Build the entity tag of a response, which changes whenever the store version, the query or the encoding does
+  // Weak, as a body built just after a change may be filed under the version before it
+  static std::string makeETag(const std::string& key, std::uint64_t storeVersion, Compression::Encoding encoding);
+
+  // Retrieve the variant for a negotiated encoding built from the given store version, a null body on a miss
+  Response find(const std::string& key, std::uint64_t storeVersion, Compression::Encoding negotiated) const;
+  // Store the variant for a negotiated encoding built from the given store version, older versions are ignored
+  void insert(const std::string& key, std::uint64_t storeVersion, Compression::Encoding negotiated, Response response);
+
+  std::size_t size() const;
+};
+
+// Define extern response cache
+extern ResponseCache responseCache;
+
+} // namespace RestAPI
+
+#endif
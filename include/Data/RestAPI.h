@@ -6,12 +6,31 @@
 #include <Poco/Net/HTTPServerRequest.h>
 #include <Poco/Net/HTTPServerResponse.h>
 #include <Poco/Util/ServerApplication.h>
+#include "DataUtils.h"
 #include <vector>
 #include <string>
 #include <optional>
+#include <cstdint>
+#include <chrono>
 
 namespace RestAPI{
 
+// Tuning of the HTTP server, each field can be overridden by the environment variable named beside it
+struct ServerConfig {
+  std::uint16_t port{ 6969 };                               // TRAFFIC_API_PORT
+  int maxThreads{ 16 };                                     // TRAFFIC_API_THREADS, request handler threads
+  int maxQueued{ 64 };                                      // TRAFFIC_API_MAX_QUEUED, accepted connections waiting for a thread, more are refused
+  int shedQueueDepth{ 48 };                                 // TRAFFIC_API_SHED_QUEUED, queued connections at which requests get a 503, 0 disables
+                                                            // Follows maxQueued at three quarters of it unless set
+  bool keepAlive{ true };                                   // TRAFFIC_API_KEEP_ALIVE, 0 or 1
+  int maxKeepAliveRequests{ 0 };                            // TRAFFIC_API_KEEP_ALIVE_REQUESTS, 0 for no limit
+  std::chrono::seconds keepAliveTimeout{ 10 };              // TRAFFIC_API_KEEP_ALIVE_TIMEOUT
+  std::chrono::seconds timeout{ 60 };                       // TRAFFIC_API_TIMEOUT, socket send and receive
+};
+
+// Seconds a shed client is asked to wait before retrying
+constexpr int SHED_RETRY_AFTER_SECONDS{ 1 };
+
 class RequestHandler : public Poco::Net::HTTPRequestHandler {
 public:
   // Handle a request to the server
@@ -29,8 +48,16 @@ public:
 //  int main(const std::vector<std::string>& args) override;
 //};
 
+// Read the server configuration from the environment, invalid values are logged and left at their defaults
+ServerConfig loadServerConfig();
 void startApiServer();
 std::optional<std::string> findQueryParam(const std::vector<std::pair<std::string, std::string>>& queryParams, const std::string& param);
+// Parse a finite number from a query value
+std::optional<double> parseNumber(const std::string& value);
+// Parse a non-negative integer from a query value
+std::optional<std::uint64_t> parseUnsigned(const std::string& value);
+// Parse a "west,south,east,north" bounding box from a query value
+std::optional<Traffic::BoundingBox> parseBoundingBox(const std::string& value);
 
 } // namespace RestAPI
 
@@ -0,0 +1,75 @@
+#ifndef SERVERMETRICS_H
+#define SERVERMETRICS_H
+
+#include "DataUtils.h"
+#include <Poco/Net/HTTPServer.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace RestAPI {
+
+// Upper bounds of the handler latency buckets in milliseconds, slower requests fall in a final overflow bucket
+constexpr std::array<double, 12> LATENCY_BUCKETS_MS{ 0.5, 1.0, 2.5, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0 };
+
+// Counters describing the API server, updated lock-free from the request threads
+// Queue depth and thread usage are read from the running server, request counts and the handler
+// latency histogram are recorded by the handlers themselves. Latency covers the time spent in a
+// handler, not the time a connection waited in the queue, which is what the queue depth shows.
+class ServerMetrics {
+public:
+  // Counters at one point in time, each read individually so they may be off by a request in flight
+  struct Snapshot {
+    int currentThreads{ 0 };
+    int maxThreads{ 0 };
+    int queuedConnections{ 0 };
+    int maxQueued{ 0 };
+    int currentConnections{ 0 };
+    int totalConnections{ 0 };
+    int refusedConnections{ 0 };
+    std::uint64_t requests{ 0 };
+    std::uint64_t shed{ 0 };
+    std::uint64_t latencyMicros{ 0 };                                 // Sum of all handler latencies
+    std::array<std::uint64_t, LATENCY_BUCKETS_MS.size() + 1> buckets{};  // Per bucket, not cumulative
+  };
+
+private:
+  std::atomic<const Poco::Net::HTTPServer*> server{ nullptr };
+  std::atomic<int> maxQueued{ 0 };
+  std::atomic<int> shedQueueDepth{ 0 };
+  std::atomic<std::uint64_t> requests{ 0 };
+  std::atomic<std::uint64_t> shed{ 0 };
+  std::atomic<std::uint64_t> latencyMicros{ 0 };
+  std::array<std::atomic<std::uint64_t>, LATENCY_BUCKETS_MS.size() + 1> buckets{};
+
+public:
+  // Start reading queue and thread counts from a running server, shedding once shedDepth connections are queued
+  void attach(const Poco::Net::HTTPServer& running, int queueLimit, int shedDepth);
+  // Stop reading from the server, NOTE: Must be called before the server is destroyed
+  void detach();
+
+  // Whether the connection queue is deep enough that new requests should be turned away
+  bool overloaded() const;
+  int queueDepth() const;
+
+  void recordShed() { shed.fetch_add(1, std::memory_order_relaxed); }
+  // Count a handled request and its time in the handler
+  void recordRequest(std::chrono::steady_clock::duration elapsed);
+
+  Snapshot snapshot() const;
+  // Write the server counters and latency histogram as a JSON object
+  void serializeToJSON(JSON::Writer& writer) const;
+};
+
+// Estimate a latency quantile (0 to 1) in milliseconds as the upper bound of the bucket holding it
+// Returns 0 without any requests, and the largest bound when the quantile lies in the overflow bucket
+double latencyQuantile(const ServerMetrics::Snapshot& snapshot, double quantile);
+
+// Define extern server metrics
+extern ServerMetrics serverMetrics;
+
+} // namespace RestAPI
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "DataUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// A uniform grid over latitude/longitude for locating items by position
+// Items are bucketed into square cells of a fixed size in degrees, so a query
+// only visits the cells it overlaps and the items inside them
+// T must be hashable and cheap to copy (pointers, handles, ids)
+template<typename T>
+class SpatialGrid {
+private:
+  using CellKey = std::uint64_t;
+
+  struct Entry {
+    T item;
+    Location location;
+  };
+
+  double cellSize;                                        // Cell edge length in degrees
+  std::unordered_map<CellKey, std::vector<Entry>> cells;  // Occupied cells only
+  std::unordered_map<T, CellKey> itemCells;               // Reverse lookup for removals
+
+  std::int32_t toCell(double degrees) const { return static_cast<std::int32_t>(std::floor(degrees / cellSize)); }
+  static CellKey makeKey(std::int32_t x, std::int32_t y) {
+    return (static_cast<CellKey>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+  }
+
+  // Visit each item in the cells overlapping a box
+  template<typename Visitor>
+  void visitBox(const BoundingBox& box, Visitor&& visit) const {
+    std::int32_t left = toCell(box.longLeft), right = toCell(box.longRight);
+    std::int32_t bottom = toCell(box.latBottom), top = toCell(box.latTop);
+    std::int64_t boxCells = (static_cast<std::int64_t>(right) - left + 1) * (static_cast<std::int64_t>(top) - bottom + 1);
+    // Very large boxes cover more cells than are occupied, so walk the occupied cells instead
+    if(boxCells > static_cast<std::int64_t>(cells.size())) {
+      for(const auto& [key, entries] : cells)
+        for(const auto& entry : entries)
+          if(box.contains(entry.location))
+            visit(entry);
+      return;
+    }
+    for(std::int32_t x = left; x <= right; x++) {
+      for(std::int32_t y = bottom; y <= top; y++) {
+        auto cell = cells.find(makeKey(x, y));
+        if(cell == cells.end())
+          continue;
+        for(const auto& entry : cell->second)
+          if(box.contains(entry.location))
+            visit(entry);
+      }
+    }
+  }
+
+public:
+  // Default to ~5km cells, roughly the size of a dense urban viewport tile
+  explicit SpatialGrid(double cellDegrees = 0.05) : cellSize{ cellDegrees } {}
+
+  // Add an item at a location, replacing any previous position
+  void insert(const T& item, const Location& location) {
+    remove(item);
+    CellKey key = makeKey(toCell(location.longitude), toCell(location.latitude));
+    cells[key].push_back({ item, location });
+    itemCells[item] = key;
+  }
+
+  // Remove an item, returns false if it was not indexed
+  bool remove(const T& item) {
+    auto position = itemCells.find(item);
+    if(position == itemCells.end())
+      return false;
+    auto cell = cells.find(position->second);
+    if(cell != cells.end()) {
+      auto& entries = cell->second;
+      for(auto it = entries.begin(); it != entries.end(); ++it) {
+        if(it->item == item) {
+          // Order within a cell is irrelevant, swap and pop
+          *it = std::move(entries.back());
+          entries.pop_back();
+          break;
+        }
+      }
+      if(entries.empty())
+        cells.erase(cell);
+    }
+    itemCells.erase(position);
+    return true;
+  }
+
+  bool contains(const T& item) const { return itemCells.count(item) != 0; }
+  std::size_t size() const { return itemCells.size(); }
+
+  void clear() {
+    cells.clear();
+    itemCells.clear();
+  }
+
+  // Find all items inside a bounding box
+  std::vector<T> queryBox(const BoundingBox& box) const {
+    std::vector<T> matches;
+    visitBox(box, [&matches](const Entry& entry){ matches.push_back(entry.item); });
+    return matches;
+  }
+
+  // Find all items within a radius (km) of a point
+  std::vector<T> queryRadius(const Location& center, double radiusKm) const {
+    std::vector<T> matches;
+    visitBox(boundingBox(center, radiusKm), [&](const Entry& entry){
+      if(distanceKm(center, entry.location) <= radiusKm)
+        matches.push_back(entry.item);
+    });
+    return matches;
+  }
+
+  // Find the k closest items within a radius (km) of a point, with their distances, closest first
+  std::vector<std::pair<T, double>> queryNearest(const Location& center, std::size_t k, double radiusKm) const {
+    std::vector<std::pair<T, double>> matches;
+    visitBox(boundingBox(center, radiusKm), [&](const Entry& entry){
+      double distance = distanceKm(center, entry.location);
+      if(distance <= radiusKm)
+        matches.emplace_back(entry.item, distance);
+    });
+    auto closer = [](const auto& a, const auto& b){ return a.second < b.second; };
+    if(matches.size() > k) {
+      std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(k), matches.end(), closer);
+      matches.resize(k);
+    } else {
+      std::sort(matches.begin(), matches.end(), closer);
+    }
+    return matches;
+  }
+};
+
+} // namespace Traffic
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Shared table of interned strings for values that repeat across many events
+// (URLs, statuses, road names, directions). Each distinct value is stored once
+// and events hold an 8-byte reference counted handle to it.
+namespace Intern {
+
+struct Entry {
+  const std::string value;
+  std::atomic<std::uint32_t> refs{ 0 };
+
+  explicit Entry(std::string_view text) : value{ text } {}
+};
+
+// Handle to an interned string
+// Handles are immutable views, copying only bumps a reference count
+class String {
+private:
+  Entry* entry{ nullptr };    // nullptr represents the empty string
+
+  void release();
+public:
+  // Constructors
+  String() = default;
+  String(std::string_view value);
+  String(const std::string& value) : String(std::string_view(value)) {}
+  String(const std::pmr::string& value) : String(std::string_view(value)) {}
+  String(const char* value) : String(std::string_view(value)) {}
+  String(const String& other);
+  String(String&& other) noexcept;
+  ~String() { release(); }
+
+  // Operators
+  String& operator=(const String& other);
+  String& operator=(String&& other) noexcept;
+  // Identical values share an entry, so handles compare by address
+  bool operator==(const String& other) const { return entry == other.entry; }
+  bool operator==(std::string_view other) const { return view() == other; }
+  bool operator==(const char* other) const { return view() == other; }
+  friend std::ostream& operator<<(std::ostream& out, const String& string) { return out << string.view(); }
+
+  // Accessors
+  const std::string& str() const;
+  std::string_view view() const { return str(); }
+  bool empty() const { return str().empty(); }
+};
+
+// Number of distinct strings and their total character bytes held by the table
+std::size_t size();
+std::size_t bytes();
+// Drop strings which are no longer referenced by any handle, returns the number removed
+std::size_t purge();
+
+} // namespace Intern
+
+#endif
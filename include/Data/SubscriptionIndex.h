@@ -0,0 +1,168 @@
+#ifndef SUBSCRIPTIONINDEX_H
+#define SUBSCRIPTIONINDEX_H
+
+#include "DataUtils.h"
+#include "Traffic.h"
+#include "EventStore.h"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RestAPI {
+
+// Cell edge length of the box index in degrees, coarser than the event grid since boxes are viewport sized
+constexpr double SUBSCRIPTION_CELL_DEGREES{ 0.25 };
+// Boxes covering more cells than this are not indexed, they are checked against every located event
+constexpr std::int64_t SUBSCRIPTION_MAX_BOX_CELLS{ 256 };
+
+// Filters a streaming client subscribes with, unset filters match everything
+struct Subscription {
+  std::optional<Traffic::Region> region;
+  std::optional<Traffic::DataSource> source;
+  std::optional<Traffic::BoundingBox> box;    // Only located events can match a box
+
+  Subscription() = default;
+  Subscription(const Subscription& other) = default;
+  // BoundingBox is not assignable, so the box is rebuilt in place
+  Subscription& operator=(const Subscription& other) {
+    region = other.region;
+    source = other.source;
+    box.reset();
+    if(other.box)
+      box.emplace(*other.box);
+    return *this;
+  }
+
+  bool matches(Traffic::Region eventRegion, Traffic::DataSource eventSource, const std::optional<Traffic::Location>& location) const {
+    if((region && *region != eventRegion) || (source && *source != eventSource))
+      return false;
+    return !box || (location && box->contains(*location));
+  }
+};
+
+// Index of subscriptions for finding the subscribers an event may concern without scanning them all
+// Subscriptions without a box sit in one bucket per (region or any, source or any) pair, so an event
+// is looked up in four buckets. Subscriptions with a box are listed in every grid cell the box
+// overlaps, so a located event is looked up in its own cell, and their region and source are left
+// to the caller to check. Each subscriber is visited at most once per lookup
+// T must be hashable and cheap to copy (pointers, handles, ids)
+template<typename T>
+class SubscriptionIndex {
+private:
+  using CellKey = std::uint64_t;
+
+  static constexpr std::size_t ANY_REGION{ Traffic::REGION_COUNT };
+  static constexpr std::size_t ANY_SOURCE{ Traffic::SOURCE_COUNT };
+
+  // Where a subscriber is listed, used to remove it
+  struct Placement {
+    std::size_t bucket{ 0 };            // Bucket of a subscription without a box
+    std::vector<CellKey> cells;         // Cells of an indexed box
+    bool boxed{ false };
+    bool wide{ false };                 // Box too large to index
+  };
+
+  std::array<std::vector<T>, (Traffic::REGION_COUNT + 1) * (Traffic::SOURCE_COUNT + 1)> buckets;
+  std::unordered_map<CellKey, std::vector<T>> cells;    // Occupied cells only
+  std::vector<T> wide;
+  std::unordered_map<T, Placement> placements;
+
+  static std::size_t bucketIndex(std::size_t region, std::size_t source) { return region * (Traffic::SOURCE_COUNT + 1) + source; }
+  static std::int32_t toCell(double degrees) { return static_cast<std::int32_t>(std::floor(degrees / SUBSCRIPTION_CELL_DEGREES)); }
+  static CellKey makeKey(std::int32_t x, std::int32_t y) {
+    return (static_cast<CellKey>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+  }
+  // Order within a list is irrelevant, swap and pop
+  static void eraseFrom(std::vector<T>& items, const T& item) {
+    for(auto it = items.begin(); it != items.end(); ++it) {
+      if(*it == item) {
+        *it = std::move(items.back());
+        items.pop_back();
+        return;
+      }
+    }
+  }
+
+public:
+  // Add a subscriber, replacing any previous subscription
+  void insert(const T& item, const Subscription& subscription) {
+    remove(item);
+    Placement placement;
+    if(subscription.box) {
+      const Traffic::BoundingBox& box = *subscription.box;
+      std::int32_t left = toCell(box.longLeft), right = toCell(box.longRight);
+      std::int32_t bottom = toCell(box.latBottom), top = toCell(box.latTop);
+      placement.boxed = true;
+      if((static_cast<std::int64_t>(right) - left + 1) * (static_cast<std::int64_t>(top) - bottom + 1) > SUBSCRIPTION_MAX_BOX_CELLS) {
+        placement.wide = true;
+        wide.push_back(item);
+      } else {
+        for(std::int32_t x = left; x <= right; x++) {
+          for(std::int32_t y = bottom; y <= top; y++) {
+            CellKey key = makeKey(x, y);
+            cells[key].push_back(item);
+            placement.cells.push_back(key);
+          }
+        }
+      }
+    } else {
+      placement.bucket = bucketIndex(subscription.region ? static_cast<std::size_t>(*subscription.region) : ANY_REGION,
+                                     subscription.source ? static_cast<std::size_t>(*subscription.source) : ANY_SOURCE);
+      buckets[placement.bucket].push_back(item);
+    }
+    placements.emplace(item, std::move(placement));
+  }
+
+  // Remove a subscriber, returns false if it was not indexed
+  bool remove(const T& item) {
+    auto found = placements.find(item);
+    if(found == placements.end())
+      return false;
+    const Placement& placement = found->second;
+    if(!placement.boxed) {
+      eraseFrom(buckets[placement.bucket], item);
+    } else if(placement.wide) {
+      eraseFrom(wide, item);
+    } else {
+      for(CellKey key : placement.cells) {
+        auto cell = cells.find(key);
+        if(cell == cells.end())
+          continue;
+        eraseFrom(cell->second, item);
+        if(cell->second.empty())
+          cells.erase(cell);
+      }
+    }
+    placements.erase(found);
+    return true;
+  }
+
+  // Visit every subscriber an event with these fields may match, the caller confirms the match
+  template<typename Visitor>
+  void visitCandidates(Traffic::Region region, Traffic::DataSource source, const std::optional<Traffic::Location>& location, Visitor&& visit) const {
+    for(std::size_t regionKey : { static_cast<std::size_t>(region), ANY_REGION })
+      for(std::size_t sourceKey : { static_cast<std::size_t>(source), ANY_SOURCE })
+        for(const T& item : buckets[bucketIndex(regionKey, sourceKey)])
+          visit(item);
+    if(!location)
+      return;
+    auto cell = cells.find(makeKey(toCell(location->longitude), toCell(location->latitude)));
+    if(cell != cells.end())
+      for(const T& item : cell->second)
+        visit(item);
+    for(const T& item : wide)
+      visit(item);
+  }
+
+  bool contains(const T& item) const { return placements.count(item) != 0; }
+  std::size_t size() const { return placements.size(); }
+};
+
+} // namespace RestAPI
+
+#endif
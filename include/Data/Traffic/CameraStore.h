@@ -0,0 +1,82 @@
+#ifndef CAMERASTORE_H
+#define CAMERASTORE_H
+
+#include "Traffic.h"
+#include "EventStore.h"
+#include "SpatialIndex.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// Number of cameras linked to each event, and how far from the event they may be
+constexpr std::size_t NEAREST_CAMERA_COUNT{ 3 };
+constexpr double NEAREST_CAMERA_RADIUS_KM{ 5.0 };
+
+// Cameras for every market, refreshed in bulk and read concurrently
+// Refreshes replace all of a source's cameras at once under an exclusive lock, reads take a
+// shared lock so API requests never wait on each other
+class CameraStore {
+public:
+  using Handle = std::uint32_t;
+
+private:
+  mutable std::shared_mutex mutex;
+  std::vector<Camera> cameras;                              // Indexed by handle
+  std::array<std::vector<Handle>, REGION_COUNT> regionIndex;
+  SpatialGrid<Handle> spatialIndex;
+  SpatialGrid<Handle> onlineIndex;                          // Online cameras only, searched when linking events
+
+  // Rebuild the indexes after the camera list changes
+  // NOTE: The exclusive lock must be held
+  void reindex();
+
+public:
+  // Replace every camera from a source
+  void replace(DataSource source, std::vector<Camera>&& updated);
+
+  // Visit the cameras matching the optional region and bounding box filters under a shared lock
+  template<typename Visitor>
+  void visit(std::optional<Region> region, const std::optional<BoundingBox>& box, Visitor&& visitor) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if(box) {
+      for(Handle handle : spatialIndex.queryBox(*box))
+        if(!region || cameras[handle].getRegion() == *region)
+          visitor(cameras[handle]);
+    } else if(region) {
+      for(Handle handle : regionIndex[static_cast<std::size_t>(*region)])
+        visitor(cameras[handle]);
+    } else {
+      for(const Camera& camera : cameras)
+        visitor(camera);
+    }
+  }
+
+  // Find the closest online cameras to a location, closest first
+  std::vector<NearbyCamera> nearest(const Location& location, std::size_t count, double radiusKm) const;
+
+  std::size_t size() const;
+};
+
+// Define extern camera store
+extern CameraStore cameraStore;
+
+// Link an event to its nearest cameras, events without a location are linked to none
+// Used as the event store's store handler so each inserted or updated event is linked as it is stored
+void linkCameras(Event& event);
+// Relink every event after the cameras change
+// NOTE: Locks eventsMutex, it must not already be held
+void linkCameras(EventStore& store);
+
+// Serialize the cameras matching the "region" and "bbox" query parameters
+std::optional<std::string> serializeCamerasToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams);
+
+} // namespace Traffic
+
+#endif
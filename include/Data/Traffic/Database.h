@@ -0,0 +1,125 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include "Traffic.h"
+#include "EventStore.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace Traffic {
+
+// Default database file
+extern const std::string DATABASE_PATH;
+// Batches waiting for the writer, past this point they are dropped and the next capture rewrites every event
+constexpr std::size_t DATABASE_QUEUE_LIMIT{ 8 };
+
+// Row values for one event, copied out of the store so the writer never touches it
+struct EventRow {
+  std::string id;               // Source qualified event ID ("NYSDOT:123")
+  Region region;
+  std::string roadway;
+  std::string category;
+  std::string status;
+  std::optional<std::string> direction;
+  std::string details;
+  std::int64_t reported;
+  std::int64_t updated;
+  std::optional<Location> location;
+};
+
+// Changes captured from one poll cycle
+struct PersistBatch {
+  bool full{ false };                   // Replace every stored event (first sync, or the change log was outrun)
+  std::vector<EventRow> upserts;
+  std::vector<std::string> deletes;
+};
+
+// Write-behind persistence of the live events into the relational schema (database/scripts/create_tables.sql)
+// Once per cycle the ingestion thread copies the changes since the last batch out of the store's change
+// log, a background writer applies each batch inside a single transaction using prepared statements.
+// NOTE: IDs are only unique within a source, so event_id holds the source with the ID ("NYSDOT:123")
+class EventDatabase {
+private:
+  // Prepared statements, compiled once when the database is opened
+  struct Statements {
+    sqlite3_stmt* begin{ nullptr };
+    sqlite3_stmt* commit{ nullptr };
+    sqlite3_stmt* rollback{ nullptr };
+    sqlite3_stmt* clearCoordinates{ nullptr };
+    sqlite3_stmt* clearEvents{ nullptr };
+    sqlite3_stmt* insertRoadway{ nullptr };
+    sqlite3_stmt* selectRoadway{ nullptr };
+    sqlite3_stmt* insertCategory{ nullptr };
+    sqlite3_stmt* selectCategory{ nullptr };
+    sqlite3_stmt* insertStatus{ nullptr };
+    sqlite3_stmt* selectStatus{ nullptr };
+    sqlite3_stmt* upsertEvent{ nullptr };
+    sqlite3_stmt* upsertCoordinates{ nullptr };
+    sqlite3_stmt* deleteCoordinates{ nullptr };
+    sqlite3_stmt* deleteEvent{ nullptr };
+  };
+
+  sqlite3* db{ nullptr };
+  Statements statements;
+  // Lookup IDs already resolved by the writer
+  std::unordered_map<std::string, std::int64_t> roadwayIDs;
+  std::unordered_map<std::string, std::int64_t> categoryIDs;
+  std::unordered_map<std::string, std::int64_t> statusIDs;
+
+  // Last store sequence captured, only used by the ingestion thread
+  std::uint64_t persistedSequence{ 0 };
+  // Set when a batch fails or queued batches are dropped, the next capture rewrites every event
+  std::atomic<bool> resync{ false };
+
+  // Writer queue
+  std::mutex queueMutex;
+  std::condition_variable queueReady;
+  std::deque<PersistBatch> queue;
+  bool stopping{ false };
+  std::thread writer;
+
+  bool prepare();
+  bool execute(sqlite3_stmt* statement);
+  std::optional<std::int64_t> lookup(std::unordered_map<std::string, std::int64_t>& cache, const std::string& key,
+                                     sqlite3_stmt* insert, sqlite3_stmt* select, std::optional<std::int64_t> regionID);
+  bool writeRow(const EventRow& row);
+  bool apply(const PersistBatch& batch);
+  void writeLoop();
+
+public:
+  EventDatabase() = default;
+  ~EventDatabase();
+
+  // Open the database and create any missing tables
+  bool open(const std::string& path);
+  // Start and stop the background writer, stopping drains any queued batches
+  void start();
+  void stop();
+
+  // Copy the store's changes since the last call into a batch for the writer
+  // NOTE: Must be called without eventsMutex held, it is locked only while the rows are copied
+  void capture(const EventStore& store);
+
+  // Delete the copy constructor and assignment operator
+  EventDatabase(const EventDatabase&) = delete;
+  EventDatabase& operator=(const EventDatabase&) = delete;
+};
+
+// Define extern event database
+extern EventDatabase eventDatabase;
+
+} // namespace Traffic
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef EVENTSTORE_H
+#define EVENTSTORE_H
+
+#include "Traffic.h"
+#include "SpatialIndex.h"
+#include "KeyTable.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// Number of values in each filterable enum (UNKNOWN is always the last member)
+constexpr std::size_t REGION_COUNT{ static_cast<std::size_t>(Region::UNKNOWN) + 1 };
+constexpr std::size_t SOURCE_COUNT{ static_cast<std::size_t>(DataSource::UNKNOWN) + 1 };
+
+// Number of changes kept for delta reads, older changes require a full reload
+constexpr std::size_t CHANGE_LOG_CAPACITY{ 8192 };
+
+enum class ChangeType : std::uint8_t {
+  Insert,
+  Update,
+  Delete
+};
+constexpr std::size_t CHANGE_TYPE_COUNT{ static_cast<std::size_t>(ChangeType::Delete) + 1 };
+
+std::string_view toString(const ChangeType& type);
+
+// A single mutation of the store
+struct Change {
+  std::uint64_t sequence;
+  ChangeType type;
+  DataSource source;
+  std::string id;
+};
+
+// Result of reading the change log
+struct ChangeSet {
+  std::uint64_t sequence;         // Current store sequence, pass back as "since" on the next read
+  bool reset;                     // The requested changes have been evicted, reload the full event list
+  std::vector<const Change*> changes;
+};
+
+// Keyed storage for all traffic events
+// Events are keyed by (source, ID) and live in slots addressed by a small handle. The fields used for filtering are
+// mirrored into a dense array of summaries so scans never touch the string data, and
+// secondary indexes by region, by source, and by (region, source) hold handles so that
+// filtered reads only visit matching events
+// NOTE: The store is not internally synchronized, callers must hold eventsMutex
+class EventStore {
+public:
+  using Handle = std::uint32_t;
+  // Receives each event version as it leaves the store (replaced by an update, or deleted)
+  using RetireHandler = std::function<void(Event&&, ChangeType)>;
+  // Receives each event version as it enters the store (inserted, or replacing an update), may modify it
+  using StoreHandler = std::function<void(Event&)>;
+
+private:
+  using IndexSet = std::unordered_set<Handle>;
+
+  // Hot per-slot data, kept small so a full scan streams through cache
+  struct Slot {
+    EventSummary summary;
+    bool live{ false };
+  };
+
+  std::vector<Slot> slots;                          // Hot data, indexed by handle
+  std::deque<Event> events;                         // Cold data, indexed by handle (stable addresses)
+  std::vector<Handle> freeSlots;                    // Erased handles available for reuse
+  KeyTable keys;                                    // Hashed (source, ID) to handle
+  std::array<IndexSet, REGION_COUNT> regionIndex;
+  std::array<IndexSet, SOURCE_COUNT> sourceIndex;
+  std::array<IndexSet, REGION_COUNT * SOURCE_COUNT> pairIndex;
+  SpatialGrid<Handle> spatialIndex;                 // Events with a known location
+  std::uint64_t sequence{ initialSequence() };      // Sequence number of the last change
+  std::atomic<std::uint64_t> version{ initialSequence() };   // Bumped by every change, including unlogged in-place edits (never reused across runs)
+                                                            // Only bumped with eventsMutex held, but readable without it
+  std::deque<Change> changeLog;                     // Most recent changes, oldest first
+  RetireHandler retireHandler;
+  StoreHandler storeHandler;
+
+  // Get the index buckets a handle belongs to
+  IndexSet& regionBucket(Region region) { return regionIndex[static_cast<std::size_t>(region)]; }
+  IndexSet& sourceBucket(DataSource source) { return sourceIndex[static_cast<std::size_t>(source)]; }
+  IndexSet& pairBucket(Region region, DataSource source) {
+    return pairIndex[static_cast<std::size_t>(region) * SOURCE_COUNT + static_cast<std::size_t>(source)];
+  }
+  const IndexSet& selectBucket(std::optional<Region> region, std::optional<DataSource> source) const;
+
+  // Starting sequence number, taken from the clock so numbers from a previous run are never reused
+  static std::uint64_t initialSequence();
+  // Hash a (source, ID) key
+  static std::uint64_t hashKey(DataSource source, std::string_view id);
+  // Predicate confirming that a handle holds the given key
+  auto matchesKey(DataSource source, std::string_view id) const {
+    return [this, source, id](Handle handle){
+      return slots[handle].summary.dataSource == source && events[handle].getID() == id;
+    };
+  }
+  Handle allocate(Event&& event);
+  void addToIndexes(Handle handle);
+  void removeFromIndexes(Handle handle);
+  // Assign the next sequence number to a change and append it to the log
+  void recordChange(ChangeType type, DataSource source, std::string_view id);
+  // Keep handles which also pass the region and source filters
+  std::vector<const Event*> filter(const std::vector<Handle>& candidates, std::optional<Region> region, std::optional<DataSource> source) const;
+
+public:
+  // Insert a new event constructed from args if the key is not already present
+  // Returns the stored event and whether it was inserted
+  // NOTE: The constructed event's source and ID must match the key, they are used to verify hash matches
+  template<typename... Args>
+  std::pair<Event*, bool> tryEmplace(DataSource source, std::string_view id, Args&&... args) {
+    std::uint64_t hash = hashKey(source, id);
+    if(auto found = keys.find(hash, matchesKey(source, id)))
+      return { &events[*found], false };
+    Handle handle = allocate(Event(std::forward<Args>(args)...));
+    if(storeHandler)
+      storeHandler(events[handle]);
+    keys.insert(hash, handle);
+    addToIndexes(handle);
+    recordChange(ChangeType::Insert, source, id);
+    return { &events[handle], true };
+  }
+
+  // Replace a stored event with an updated version, re-indexing as needed
+  // Returns false if the key was not found
+  bool update(DataSource source, std::string_view id, Event&& updated);
+  // Remove an event by key, returns false if the key was not found
+  bool erase(DataSource source, std::string_view id);
+
+  // Set the handler for retired event versions, it is called with the store locked so must not block
+  void setRetireHandler(RetireHandler handler) { retireHandler = std::move(handler); }
+  // Set the handler for stored event versions, it is also called with the store locked
+  void setStoreHandler(StoreHandler handler) { storeHandler = std::move(handler); }
+
+  // Accessors
+  Event* find(DataSource source, std::string_view id);
+  const Event* find(DataSource source, std::string_view id) const;
+  std::uint64_t currentSequence() const { return sequence; }
+  // Version of the stored data, anything derived from an older version is stale
+  // Safe to read without eventsMutex, the result may already be behind a writer holding it
+  std::uint64_t currentVersion() const { return version.load(std::memory_order_acquire); }
+  // Record that events were modified in place without going through update()
+  void touch() { version.fetch_add(1, std::memory_order_release); }
+  std::size_t size() const { return keys.size(); }
+  bool empty() const { return keys.empty(); }
+
+  // Retrieve events matching the optional region and source filters
+  // Cost is proportional to the number of matching events
+  std::vector<Event*> select(std::optional<Region> region, std::optional<DataSource> source);
+  std::vector<const Event*> select(std::optional<Region> region, std::optional<DataSource> source) const;
+  // Retrieve located events inside a bounding box or within a radius (km) of a point
+  // Cost is proportional to the number of events in the covered grid cells
+  std::vector<const Event*> selectWithin(const BoundingBox& box, std::optional<Region> region, std::optional<DataSource> source) const;
+  std::vector<const Event*> selectNear(const Location& center, double radiusKm, std::optional<Region> region, std::optional<DataSource> source) const;
+
+  // Retrieve the changes made after a sequence number, keeping only the latest change to each event
+  // Cost is proportional to the number of changes since then
+  ChangeSet changesSince(std::uint64_t since) const;
+};
+
+// Define extern event store
+extern EventStore mapEvents;
+
+} // namespace Traffic
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "Traffic.h"
+#include "EventStore.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// Default history file and size
+extern const std::string HISTORY_PATH;
+constexpr std::size_t HISTORY_CAPACITY{ 64 * 1024 * 1024 };
+// Retired events waiting for the writer, older entries are dropped past this point
+constexpr std::size_t HISTORY_QUEUE_LIMIT{ 65536 };
+// Largest number of records returned by a single query
+constexpr std::size_t HISTORY_QUERY_LIMIT{ 1000 };
+
+// A retired event version read back from the log
+struct HistoryRecord {
+  std::int64_t retiredAt;       // Seconds since the UNIX epoch
+  ChangeType reason;            // Update (superseded by a newer version) or Delete (cleared from the feed)
+  DataSource source;
+  std::string id;
+  std::string json;             // The event as serialized by Event::getJSONFragment
+};
+
+// Filters for reading the history log
+struct HistoryQuery {
+  std::optional<DataSource> source;
+  std::optional<std::string> id;
+  std::optional<std::int64_t> from;   // Match versions active at or after this time
+  std::optional<std::int64_t> to;     // Match versions active at or before this time
+  std::size_t limit{ 100 };           // Most recent matches to return
+};
+
+// Bounded, append-only log of events which left the live store
+// The log is a ring of variable length records in a memory-mapped file, once full the oldest
+// records are overwritten. The ingestion thread only moves retired events onto a queue, a
+// background writer serializes them and appends them to the file.
+// Records are indexed in memory by event and in retirement order, so queries only read the
+// records they return instead of scanning the ring.
+class HistoryLog {
+private:
+  // Stored at the start of the file
+  struct FileHeader {
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t capacity;     // Size of the file in bytes
+    std::uint64_t head;         // Offset of the next write
+    std::uint64_t tail;         // Offset of the oldest record
+    std::uint64_t records;      // Number of records in the ring
+  };
+
+  // Stored before each record, followed by the ID and the JSON payload
+  struct RecordHeader {
+    std::uint32_t magic;
+    std::uint32_t length;         // Total record length including this header and padding
+    std::int64_t retiredAt;
+    std::int64_t activeFrom;      // Time reported, or last updated if unknown
+    std::uint32_t payloadLength;
+    std::uint16_t idLength;
+    std::uint8_t source;
+    std::uint8_t reason;
+  };
+
+  struct Pending {
+    Event event;
+    ChangeType reason;
+    std::int64_t retiredAt;
+  };
+
+  // A record in the ring, kept in memory so filters never touch the mapped file
+  struct IndexEntry {
+    std::uint64_t offset;
+    std::int64_t retiredAt;
+    std::int64_t activeFrom;
+    DataSource source;
+  };
+
+  // Mapped file
+  int fd{ -1 };
+  std::byte* mapping{ nullptr };
+  std::size_t mappingSize{ 0 };
+  mutable std::mutex fileMutex;
+
+  // Record index, guarded by fileMutex
+  // Records are numbered in the order they were appended, which is also the order they were retired
+  std::deque<IndexEntry> order;                                                 // Oldest record first
+  std::uint64_t firstSequence{ 0 };                                             // Number of order.front()
+  std::unordered_map<EventKey, std::vector<std::uint64_t>, EventKeyHash> versions;   // Record numbers of each event, oldest first
+
+  // Writer queue
+  std::mutex queueMutex;
+  std::condition_variable queueReady;
+  std::deque<Pending> queue;
+  std::size_t dropped{ 0 };
+  bool stopping{ false };
+  std::thread writer;
+
+  FileHeader& header() const { return *reinterpret_cast<FileHeader*>(mapping); }
+  const RecordHeader* recordAt(std::uint64_t offset) const;
+  std::uint64_t dataStart() const;
+  // Add the newest record to the index, or rebuild it from the ring (false if a record is damaged)
+  void indexRecord(const RecordHeader& record, std::uint64_t offset);
+  bool rebuildIndex();
+  void evictOldest();
+  void append(const Pending& pending);
+  void writeLoop();
+
+public:
+  HistoryLog() = default;
+  ~HistoryLog();
+
+  // Map the log file, reusing existing history if the file is compatible
+  bool open(const std::string& path, std::size_t capacity);
+  // Start and stop the background writer
+  void start();
+  void stop();
+
+  // Queue an event which was replaced or removed from the store, never blocks on I/O
+  void retire(Event&& event, ChangeType reason);
+
+  // Read the most recent matching records, oldest first
+  std::vector<HistoryRecord> query(const HistoryQuery& filters) const;
+
+  // Delete the copy constructor and assignment operator
+  HistoryLog(const HistoryLog&) = delete;
+  HistoryLog& operator=(const HistoryLog&) = delete;
+};
+
+// Define extern history log
+extern HistoryLog eventHistory;
+
+// Read the "id", "source", "from", "to" and "limit" query parameters
+std::optional<HistoryQuery> parseHistoryQuery(const std::vector<std::pair<std::string, std::string>>& queryParams);
+// Write the retired events matching a query as a JSON array
+void writeHistoryJSON(const HistoryQuery& filters, JSON::Writer& writer);
+
+} // namespace Traffic
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef INCIDENTS_H
+#define INCIDENTS_H
+
+#include "Traffic.h"
+#include "EventStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// Events from different sources are the same incident when they are this close in space and time
+constexpr double INCIDENT_DISTANCE_KM{ 0.5 };
+constexpr double INCIDENT_UNNAMED_DISTANCE_KM{ 0.2 };  // Tighter limit when either road name is unknown
+constexpr std::int64_t INCIDENT_WINDOW_SECONDS{ 30 * 60 };
+
+// Groups events reported by several sources into incidents
+// Each located event is hashed into a spatial-temporal bucket (a grid cell and a time window), and
+// candidate duplicates are only looked for in the neighbouring buckets. The index follows the
+// store's change log, so each update costs time proportional to the number of changed events.
+// NOTE: The index is not internally synchronized, callers must hold eventsMutex
+class IncidentIndex {
+private:
+  struct Member {
+    DataSource source;
+    Location location;
+    bool located;
+    std::int64_t time;                  // Reported time, or last updated if unknown
+    std::vector<std::string> road;      // Normalized road name tokens
+    std::uint64_t bucket;
+    std::uint64_t incident;
+  };
+
+  std::unordered_map<EventKey, Member, EventKeyHash> members;
+  std::unordered_map<std::uint64_t, std::vector<EventKey>> buckets;         // Spatial-temporal bucket to located members
+  std::unordered_map<std::uint64_t, std::vector<EventKey>> incidents;       // Incident ID to members
+  std::uint64_t nextIncident{ 1 };
+  std::uint64_t indexedSequence{ 0 };
+
+  static std::uint64_t bucketKey(std::int32_t x, std::int32_t y, std::int64_t t);
+  static bool sameIncident(const Member& a, const Member& b);
+  // Index an event, reusing the preferred incident ID if it matches nothing and the ID is free
+  void add(const EventKey& key, const Event& event, std::uint64_t preferred = 0);
+  // Remove an event, returning the incident it belonged to (0 if it was not indexed)
+  std::uint64_t remove(const EventKey& key);
+  // Remove an event from its bucket and incident without regrouping the rest
+  std::optional<Member> detach(const EventKey& key);
+  // Place a detached event, joining (and merging) any incidents it matches
+  void place(const EventKey& key, Member&& member, std::uint64_t preferred);
+
+public:
+  // Apply the store's changes since the last update, rebuilding if the change log was outrun
+  void update(const EventStore& store);
+
+  // Visit each incident's member keys
+  template<typename Visitor>
+  void forEach(Visitor&& visit) const {
+    for(const auto& [id, keys] : incidents)
+      visit(id, keys);
+  }
+
+  std::size_t size() const { return incidents.size(); }
+};
+
+// Define extern incident index
+extern IncidentIndex incidentIndex;
+
+// Serialize merged incidents matching the "region" and "source" query parameters
+std::optional<std::string> serializeIncidentsToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams);
+
+} // namespace Traffic
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef KEYTABLE_H
+#define KEYTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace Traffic {
+
+// Flat open-addressing table mapping a 64-bit key hash to a store handle
+// Buckets are probed linearly and removals shift later entries back, so there are no
+// tombstones and lookups stop at the first empty bucket. Only the hash is stored;
+// callers pass a predicate to confirm a candidate against the real key on a hash match.
+class KeyTable {
+public:
+  using Handle = std::uint32_t;
+  static constexpr Handle EMPTY{ std::numeric_limits<Handle>::max() };
+
+private:
+  struct Bucket {
+    std::uint64_t hash{ 0 };
+    Handle handle{ EMPTY };
+  };
+
+  std::vector<Bucket> buckets;
+  std::size_t count{ 0 };
+
+  std::size_t mask() const { return buckets.size() - 1; }
+  void grow();
+
+public:
+  explicit KeyTable(std::size_t initialCapacity = 64);
+
+  // Find the handle for a hash whose stored key satisfies match(handle)
+  template<typename Match>
+  std::optional<Handle> find(std::uint64_t hash, Match&& match) const {
+    for(std::size_t i = hash & mask();; i = (i + 1) & mask()) {
+      const Bucket& bucket = buckets[i];
+      if(bucket.handle == EMPTY)
+        return std::nullopt;
+      if(bucket.hash == hash && match(bucket.handle))
+        return bucket.handle;
+    }
+  }
+
+  // Add a handle, the caller must have checked that its key is not already present
+  void insert(std::uint64_t hash, Handle handle);
+
+  // Remove the entry whose stored key satisfies match(handle), returns the removed handle
+  template<typename Match>
+  std::optional<Handle> erase(std::uint64_t hash, Match&& match) {
+    for(std::size_t i = hash & mask();; i = (i + 1) & mask()) {
+      Bucket& bucket = buckets[i];
+      if(bucket.handle == EMPTY)
+        return std::nullopt;
+      if(bucket.hash == hash && match(bucket.handle)) {
+        Handle handle = bucket.handle;
+        removeAt(i);
+        return handle;
+      }
+    }
+  }
+
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  std::size_t capacity() const { return buckets.size(); }
+
+private:
+  void removeAt(std::size_t position);
+};
+
+} // namespace Traffic
+
+#endif
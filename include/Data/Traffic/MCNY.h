@@ -2,6 +2,7 @@
 #define MCNY_H
 
 #include <rapidxml.hpp>
+#include <memory_resource>
 #include <string>
 #include <optional>
 #include <tuple>
@@ -10,11 +11,14 @@ namespace Traffic {
 namespace MCNY {
 extern const std::string EVENTS_URL;
 
+// Title, main street, direction (optional), cross street (optional), allocated from the parse arena
+using titleStr = std::tuple<std::pmr::string, std::pmr::string, std::optional<std::pmr::string>, std::optional<std::pmr::string>>;
+
 bool processEvent(rapidxml::xml_node<>* parsedEvent);
 std::pair<std::string, std::string> parseDescription(rapidxml::xml_node<>* description);
 
 // Process title into and street name and (optional) direction
-std::optional<std::tuple<std::string, std::string, std::optional<std::string>, std::optional<std::string>>> processTitle(const std::string& address);
+std::optional<titleStr> processTitle(const std::string& address);
 }
 }
 
@@ -11,10 +11,16 @@ namespace NYSDOT {
   extern const std::string EVENTS_URL;
   extern const std::string CAMERAS_URL;
   extern const BoundingBox regionSyracuse;
+  extern const BoundingBox regionRochester;
+  extern const BoundingBox regionBuffalo;
+  extern const BoundingBox regionAlbany;
+  extern const BoundingBox regionBinghamton;
 
+// Read the API key from the environment, NOTE: Must be called before the fetch threads start
 void getEnv();
 bool inRegion(const Json::Value& parsedEvent);
 Region getRegion(const std::string& regionName);
+Region getRegion(const Location& location);
 
 }
 }
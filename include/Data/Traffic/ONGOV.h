@@ -19,17 +19,17 @@ bool postRequest(const std::string& url, int numPages, cURL::Handle& curlHandle)
 
 namespace Gumbo {
 // Parse data from HTML string
-std::optional<std::vector<HTML::Event>>parseData(const std::string& htmlData);  
+std::optional<HTML::EventList> parseData(const std::string& htmlData);  
 // Search parsed HTML for a table
 void searchForTable(GumboNode* rootNode, const std::string& targetClass, std::vector<GumboNode*>& tables);
 // Process a found table to extract data
-std::optional<std::vector<HTML::Event>> processTable(GumboNode* tableNode);
+std::optional<HTML::EventList> processTable(GumboNode* tableNode);
 // Process a table row into an Event and place on the vector
-void processRow(GumboElement* tableRow, std::vector<HTML::Event>& eventsVector);
+void processRow(GumboElement* tableRow, HTML::EventList& eventsVector);
 // Get the first span id from a table data element
 std::string getFirstSpanId(GumboElement* tableData);
 // Extract data from the table data element into the reference string
-void getData(GumboElement* tableData, std::string& element);
+void getData(GumboElement* tableData, std::pmr::string& element);
 void getAddressData(GumboElement* tableData, HTML::Event& event);
 void getCrossData(GumboElement* tableData, HTML::Event& event);
 }
@@ -2,6 +2,7 @@
 #define ONMT_H
 
 #include "DataUtils.h"
+#include <memory_resource>
 #include <string>
 #include <optional>
 #include <tuple>
@@ -12,7 +13,8 @@ extern const std::string EVENTS_URL;
 extern const BoundingBox regionToronto;
 extern const BoundingBox regionOttawa;
 
-std::optional<std::tuple<std::string, std::string, std::string>> parseDescription(const std::string& description);
+// Title, main street, cross street, allocated from the parse arena
+std::optional<std::tuple<std::pmr::string, std::pmr::string, std::pmr::string>> parseDescription(const std::string& description);
 }
 }
 
@@ -2,6 +2,7 @@
 #define OTT_H
 
 #include "DataUtils.h"
+#include <memory_resource>
 #include <string>
 #include <optional>
 #include <tuple>
@@ -11,7 +12,8 @@ namespace OTT {
 extern const std::string EVENTS_URL;
 extern const BoundingBox regionOttawa;
 
-using roadwayStr = std::tuple<std::string, std::optional<std::string>, std::optional<std::string>>;
+// Road, direction (optional), cross street (optional), allocated from the parse arena
+using roadwayStr = std::tuple<std::pmr::string, std::optional<std::pmr::string>, std::optional<std::pmr::string>>;
 
 std::optional<std::pair<double, double>> parseLocation(const std::string& coordinates);
 std::optional<roadwayStr> parseHeadline(const std::string& headline);
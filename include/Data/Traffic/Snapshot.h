@@ -0,0 +1,24 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "EventStore.h"
+#include <cstddef>
+#include <string>
+
+namespace Traffic {
+
+// Default snapshot file
+extern const std::string SNAPSHOT_PATH;
+
+// Checkpoint every event in the store to a compact binary file
+// The store is copied into a buffer under eventsMutex, the file is written after the lock is
+// released and atomically replaces the previous snapshot. Returns false on any I/O error.
+bool saveSnapshot(const EventStore& store, const std::string& path);
+
+// Memory-map a snapshot and insert its events into the store
+// Returns the number of events restored, a missing or invalid snapshot restores nothing
+std::size_t loadSnapshot(EventStore& store, const std::string& path);
+
+} // namespace Traffic
+
+#endif
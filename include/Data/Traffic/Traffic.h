@@ -2,22 +2,28 @@
 #define TRAFFIC_H
 
 #include "DataUtils.h"
+#include "StringPool.h"
+#include "Metrics.h"
 #include <iostream>
 #include <memory>
 #include <json/json.h>
 #include <rapidxml.hpp>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 
 namespace Traffic {
 
-enum class Region {
+enum class Region : std::uint8_t {
   Syracuse,
   Rochester,
   Buffalo,
@@ -31,7 +37,7 @@ enum class Region {
 std::ostream& operator<<(std::ostream& out, const Region& region);
 Region toRegion(const std::string& regionStr);
 
-enum class DataSource {
+enum class DataSource : std::uint8_t {
   NYSDOT,
   ONGOV,
   MCNY,
@@ -48,6 +54,40 @@ void setSource(const DataSource source);
 extern DataSource currentSource;
 //extern std::string currentCookie;
 
+// Incident status reported by the source
+// Values mirror the `event_status` table, unrecognized statuses are kept as text
+enum class EventStatus : std::uint8_t {
+  Active,
+  Dispatched,
+  EnRoute,
+  OnScene,
+  Pending,
+  Waiting,
+  Cleared,
+  Archived,
+  OTHER
+};
+std::string_view toString(const EventStatus& status);
+EventStatus toStatus(std::string_view statusStr);
+
+// Direction of travel affected by an event
+// Values mirror the `travel_direction` column, unrecognized directions are kept as text
+enum class Direction : std::uint8_t {
+  Northbound,
+  Southbound,
+  Eastbound,
+  Westbound,
+  Both,
+  Inbound,
+  Outbound,
+  InnerLoop,
+  OuterLoop,
+  UNKNOWN,
+  OTHER
+};
+std::string_view toString(const Direction& direction);
+Direction toDirection(std::string_view directionStr);
+
 class Camera {
 private:
   std::string ID;
@@ -63,7 +103,7 @@ private:
 
 public:
   // Constructors
-  Camera(const Json::Value& parsedCamera);
+  Camera(const Json::Value& parsedCamera, DataSource source);
   Camera(Camera&& other) noexcept;
   Camera& operator=(Camera&& other) noexcept;
 
@@ -76,35 +116,100 @@ public:
   Location getLocation() const { return location; }
   std::string_view getStream() const { return videoURL; }
   std::string_view getImage() const { return imageURL; }
+
+  // Rest API
+  // Serialize a camera as a JSON object
+  void serializeToJSON(JSON::Writer& writer) const;
 };
 
 // Get cameras from all sources
 bool getCameras(std::string url);
-bool parseCameras(const std::string& data);
-bool processCamera(const Json::Value& parsedCamera);
+std::optional<Camera> processCamera(const Json::Value& parsedCamera, DataSource source);
+
+// Compact fields used to filter and order events
+// Kept together at the front of each event and mirrored densely by the event store,
+// so scans never pull an event's strings through the cache
+struct EventSummary {
+  std::int64_t timeReported{ 0 };   // Seconds since the UNIX epoch (0 if unknown)
+  std::int64_t timeUpdated{ 0 };    // Seconds since the UNIX epoch (0 if unknown)
+  DataSource dataSource{ DataSource::UNKNOWN };
+  Region region{ Region::UNKNOWN };
+  EventStatus status{ EventStatus::Active };
+  Direction direction{ Direction::UNKNOWN };
+};
+
+// Top-level fields written when serializing an event, one bit per field in output order
+// id, url, title, status, main, secondary, direction, description, source, region, coordinates, reported, updated, cameras
+using EventFieldMask = std::uint16_t;
+constexpr EventFieldMask ALL_EVENT_FIELDS{ (1 << 14) - 1 };
+// Parse a comma separated list of field names, nullopt if a name is unknown or the list is empty
+std::optional<EventFieldMask> parseEventFields(const std::string& fieldList);
+
+// Largest page returned by /events when a limit is given
+constexpr std::size_t EVENTS_PAGE_LIMIT{ 1000 };
+// Largest radius (km) /events can be searched within, larger radii are rejected with a 400
+constexpr double EVENTS_RADIUS_LIMIT_KM{ 500.0 };
+
+// Encodings /events can be returned in
+enum class EventFormat : std::uint8_t {
+  JSON,
+  MessagePack,    // Integer timestamps and fixed-point coordinates
+  GeoJSON         // FeatureCollection of located events, the event JSON as properties
+};
+// Coordinates in binary responses are whole units of 1/COORDINATE_SCALE degrees (about 11 cm)
+constexpr double COORDINATE_SCALE{ 1e6 };
+
+// A camera near an event, linked by the camera store
+struct NearbyCamera {
+  Intern::String id;
+  float distanceKm;
+};
+
+// Flat view of every stored event field, used to save and restore events
+// The views point into the event or buffer they were read from and must not outlive it
+struct EventFields {
+  EventSummary summary;
+  Location location;
+  std::string_view id;
+  std::string_view url;
+  std::string_view title;
+  std::string_view statusText;
+  std::string_view directionText;
+  std::string_view mainStreet;
+  std::string_view crossStreet;
+  std::string_view description;
+};
 
 class Event {
 private:
+  // Hot fields
+  EventSummary summary;
+  // Cold fields
+  // Fields which repeat across events are interned in the shared string table
+  Location location{ 0, 0 };
   std::string ID;
-  std::string URL{ "N/A" };
-  DataSource dataSource{ DataSource::UNKNOWN };
-  Region region{ Region::UNKNOWN };
-  std::string title{ "N/A" };
-  std::string status{ "Active" };
-  std::string mainStreet{ "N/A" };
-  std::string crossStreet{ "N/A" };
-  std::string direction{ "N/A" };
+  Intern::String URL{ "N/A" };
+  Intern::String title{ "N/A" };
+  Intern::String statusText;      // Source text, only kept when status is OTHER
+  Intern::String directionText;   // Source text, only kept when direction is OTHER
+  Intern::String mainStreet{ "N/A" };
+  Intern::String crossStreet{ "N/A" };
   std::string description{ "N/A" }; // Holds full unformatted event string
-  Location location{ 0, 0 };
-  std::chrono::system_clock::time_point timeReported; // OTT 'created' "2025-03-11 12:45:00"
-  std::chrono::system_clock::time_point timeUpdated;  // OTT 'updated' "2025-03-11 12:45:00"
+  std::vector<NearbyCamera> nearbyCameras;   // Closest online cameras, closest first
+  mutable std::string jsonFragment;          // Minified JSON, built on first request and dropped when the event changes
   bool printed{ false };
+
+  // Set enum fields from source text
+  void setStatus(std::string_view statusStr);
+  void setDirection(std::string_view directionStr);
 public:
   // Constructors
+  Event() = default;
   Event(const Json::Value& parsedEvent);
   Event(const rapidxml::xml_node<>* item, const std::pair<std::string, std::string> &description);
   Event(const rapidxml::xml_node<>* item);
   Event(const HTML::Event& parsedEvent);
+  explicit Event(const EventFields& fields);
   Event(Event&& other) noexcept;
 
   // Operators
@@ -114,26 +219,56 @@ public:
   // Accessors
   void print();
   bool hasPrinted() const { return printed; }
+  const EventSummary& getSummary() const { return summary; }
   std::string_view getID() const { return ID; }
-  DataSource getSource() const { return dataSource; }
-  std::string_view getStatus() const { return status; }
-  std::chrono::system_clock::time_point getLastUpdated() const { return timeUpdated; }
-  Region getRegion() const { return region; }
+  DataSource getSource() const { return summary.dataSource; }
+  EventStatus getStatus() const { return summary.status; }
+  std::string_view getStatusText() const;
+  Direction getDirection() const { return summary.direction; }
+  std::string_view getDirectionText() const;
+  std::int64_t getUpdatedTime() const { return summary.timeUpdated; }
+  std::chrono::system_clock::time_point getLastUpdated() const { return Time::fromEpoch(summary.timeUpdated); }
+  Region getRegion() const { return summary.region; }
   Location getLocation() const { return location; }
+  bool hasLocation() const { return location.latitude != 0.0 || location.longitude != 0.0; } // 0,0 is the unset placeholder
   std::pair<double, double> getCoordinates() const { return std::make_pair(location.latitude, location.longitude); }
   std::string_view getDescription() const { return description; }
+  EventFields getFields() const;
+  const std::vector<NearbyCamera>& getNearbyCameras() const { return nearbyCameras; }
+  void setNearbyCameras(std::vector<NearbyCamera>&& cameras) { nearbyCameras = std::move(cameras); jsonFragment.clear(); }
 
   // Rest API
-  // Serialize a traffic event into a Json object
-  void serializeToJSON(Json::Value& item) const;
+  // Serialize a traffic event as a JSON object, writing only the selected fields
+  void serializeToJSON(JSON::Writer& writer, EventFieldMask fields = ALL_EVENT_FIELDS) const;
+  // Serialize a traffic event as a MessagePack map with the same keys, timestamps are seconds since the
+  // UNIX epoch, coordinates are scaled by COORDINATE_SCALE and camera distances are whole metres
+  void serializeToMsgPack(MsgPack::Writer& writer, EventFieldMask fields = ALL_EVENT_FIELDS) const;
+  // Get the event as minified JSON, only serialized again after the event changes
+  // NOTE: Builds the cached copy on first use, stored events must only be read with eventsMutex held
+  const std::string& getJSONFragment() const;
 };
 
 // Define extern event data structures
-extern std::mutex eventsMutex;
-extern std::unordered_map<std::string, Event> mapEvents;
+// NOTE: The event store itself is declared in EventStore.h
+// Lock waits and hold times are recorded for /metrics
+extern Metrics::TimedMutex eventsMutex;
+
+// Key of an event, IDs are only unique within a source
+struct EventKey {
+  DataSource source;
+  std::string id;
+
+  bool operator==(const EventKey& other) const { return source == other.source && id == other.id; }
+};
+
+struct EventKeyHash {
+  std::size_t operator()(const EventKey& key) const {
+    return std::hash<std::string>{}(key.id) ^ (static_cast<std::size_t>(key.source) * 0x9E3779B97F4A7C15ULL);
+  }
+};
 
 // And deletion data
-extern std::vector<std::string> processedKeys;
+extern std::unordered_set<EventKey, EventKeyHash> processedKeys;
 extern std::vector<DataSource> extractedSources;
 
 // Get events from all sources
@@ -142,18 +277,26 @@ void fetchCameras();
 void printEvents();
 void printEvents(Region region);
 bool getEvents(std::string url);
-bool processData(std::string& data, const std::vector<std::string>& headers);   // XML must be able to manipulate data
+bool processData(std::string& data, const cURL::Headers& headers);   // XML must be able to manipulate data
 bool parseEvents(const Json::Value& parsedData);
 bool parseEvents(std::unique_ptr<rapidxml::xml_document<>> parsedData);
-bool parseEvents(const std::vector<HTML::Event>& parsedData);
+bool parseEvents(const HTML::EventList& parsedData);
 bool processEvent(const Json::Value& parsedEvent);
 bool inMarket(const Json::Value& parsedEvent);
 Location getLocation(const Json::Value& parsedEvent);
 bool isIncident(const Json::Value& parsedEvent);
 std::chrono::system_clock::time_point getTime(const Json::Value& parsedEvent);
 void clearEvents();
-void deleteEvents(const std::vector<std::string>& keys);
-std::optional<Json::Value> serializeEventsToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams);
+void deleteEvents(DataSource source, const std::vector<std::string>& keys);
+// Names used for sources and regions in API responses (empty when unknown)
+std::string_view sourceName(DataSource dataSource);
+std::string_view regionName(Region region);
+// Serialize the events matching a query into an array in the requested format
+// With limit or cursor the array is wrapped as {"events": [...], "next": <cursor or null>}
+// GeoJSON leaves out events without coordinates and carries "next" beside the features when paged
+std::optional<std::string> serializeEvents(const std::vector<std::pair<std::string, std::string>>& queryParams, EventFormat format = EventFormat::JSON);
+// Serialize the changes since a sequence number ("since" query parameter)
+std::optional<std::string> serializeChangesToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams);
 
 } // namespace Traffic
 
@@ -0,0 +1,230 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Counters and histograms exposed in the Prometheus text format at /metrics
+// Every series is split into per-thread slots on separate cache lines. Recording is a relaxed atomic
+// add to the calling thread's slot, so threads never contend or take a lock, and reading sums the slots.
+// Families are defined once as globals and register themselves for exposition on construction.
+namespace Metrics {
+
+// Slots per series, threads beyond this share slots round robin
+constexpr std::size_t METRIC_SLOTS{ 8 };
+// Most buckets a histogram can have, besides the overflow bucket
+constexpr std::size_t MAX_HISTOGRAM_BUCKETS{ 13 };
+
+// Bucket bounds in seconds for the measured stages
+constexpr std::array<double, 11> FETCH_BUCKETS{ 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 7.5, 10.0, 20.0, 30.0 };
+constexpr std::array<double, 11> PARSE_BUCKETS{ 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0 };
+constexpr std::array<double, 13> LOCK_BUCKETS{ 0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0 };
+constexpr std::array<double, 12> REQUEST_BUCKETS{ 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5 };
+
+// Slot of the calling thread, assigned on first use
+std::size_t slotIndex();
+
+// Build label sets as the cross product of two labels, first label outermost
+// The index of a pair is first * second.size() + second
+std::vector<std::string> labelProduct(std::string_view firstName, const std::vector<std::string>& first,
+                                      std::string_view secondName, const std::vector<std::string>& second);
+// Build label sets for one label
+std::vector<std::string> labelSets(std::string_view name, const std::vector<std::string>& values);
+
+// A named family of series, each series identified by an index into its label sets
+class Family {
+private:
+  std::string name;
+  std::string help;
+protected:
+  std::vector<std::string> labels;   // Rendered as name="value" pairs, empty for a family without labels
+
+  // Write the HELP and TYPE lines
+  void writeHeader(std::string& out, std::string_view type) const;
+  // Write one sample, adding an extra label pair (such as le) when given
+  void writeSample(std::string& out, std::string_view suffix, std::size_t series, std::string_view extra, std::string_view value) const;
+public:
+  Family(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets);
+  virtual ~Family() = default;
+
+  const std::string& getName() const { return name; }
+  std::size_t size() const { return labels.size(); }
+  // Append the family in the Prometheus text format
+  virtual void write(std::string& out) const = 0;
+
+  // Delete the copy constructor and assignment operator, families are registered by address
+  Family(const Family&) = delete;
+  Family& operator=(const Family&) = delete;
+};
+
+// Monotonic counters
+class Counter : public Family {
+private:
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> value{ 0 };
+  };
+  std::unique_ptr<Slot[]> slots;    // METRIC_SLOTS per series
+public:
+  Counter(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets = { "" });
+
+  void add(std::size_t series, std::uint64_t amount = 1) {
+    slots[series * METRIC_SLOTS + slotIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+  }
+  std::uint64_t value(std::size_t series) const;
+  void write(std::string& out) const override;
+};
+
+// Values set by a single writer, such as the size of the last batch
+class Gauge : public Family {
+private:
+  std::unique_ptr<std::atomic<std::int64_t>[]> values;
+public:
+  Gauge(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets = { "" });
+
+  void set(std::size_t series, std::int64_t value) { values[series].store(value, std::memory_order_relaxed); }
+  void write(std::string& out) const override;
+};
+
+// A value read when the metrics are collected, for state owned elsewhere (queue depth, store size)
+class Sampled : public Family {
+private:
+  std::string type;
+  std::function<double()> read;
+public:
+  // Type is "gauge" or "counter"
+  Sampled(std::string familyName, std::string familyHelp, std::string sampleType, std::function<double()> reader);
+
+  void write(std::string& out) const override;
+};
+
+// Duration histograms with fixed bucket bounds
+// Only series with at least one observation are written, so sparse label sets stay cheap to scrape
+class Histogram : public Family {
+private:
+  struct alignas(64) Slot {
+    std::array<std::atomic<std::uint64_t>, MAX_HISTOGRAM_BUCKETS + 1> buckets{};   // Last is the overflow bucket
+    std::atomic<std::uint64_t> sumNanos{ 0 };
+  };
+  std::vector<std::int64_t> bounds;   // Nanoseconds, ascending
+  std::unique_ptr<Slot[]> slots;      // METRIC_SLOTS per series
+public:
+  template<std::size_t N>
+  Histogram(std::string familyName, std::string familyHelp, const std::array<double, N>& boundSeconds, std::vector<std::string> labelSets = { "" })
+    : Histogram(std::move(familyName), std::move(familyHelp), std::vector<double>(boundSeconds.begin(), boundSeconds.end()), std::move(labelSets)) {
+    static_assert(N <= MAX_HISTOGRAM_BUCKETS, "Too many histogram buckets");
+  }
+  Histogram(std::string familyName, std::string familyHelp, const std::vector<double>& boundSeconds, std::vector<std::string> labelSets);
+
+  void observe(std::size_t series, std::chrono::steady_clock::duration elapsed);
+  void write(std::string& out) const override;
+};
+
+// Observes the time until it goes out of scope
+class Timer {
+private:
+  Histogram& histogram;
+  std::size_t series;
+  std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+public:
+  Timer(Histogram& target, std::size_t targetSeries = 0) : histogram(target), series(targetSeries) {}
+  ~Timer() { histogram.observe(series, std::chrono::steady_clock::now() - start); }
+  // Change the series before the time is observed, for labels only known part way through
+  void setSeries(std::size_t targetSeries) { series = targetSeries; }
+
+  // Delete the copy constructor and assignment operator
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+};
+
+// Mutex recording how long each caller waited for it and then held it
+// Satisfies Lockable, so it is used through std::lock_guard like a std::mutex
+class TimedMutex {
+private:
+  std::mutex mutex;
+  Histogram& waitTime;
+  Histogram& holdTime;
+  std::chrono::steady_clock::time_point acquired;   // Only touched by the owning thread
+public:
+  TimedMutex(Histogram& wait, Histogram& hold) : waitTime(wait), holdTime(hold) {}
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+  // Delete the copy constructor and assignment operator
+  TimedMutex(const TimedMutex&) = delete;
+  TimedMutex& operator=(const TimedMutex&) = delete;
+};
+
+// Write every registered family in the Prometheus text exposition format (version 0.0.4)
+std::string serializeToPrometheus();
+
+// Pipeline metrics
+extern Histogram fetchSeconds;        // By source
+extern Counter fetchBytes;            // By source
+extern Counter fetchResponses;        // By source and status class
+extern Histogram parseSeconds;        // By source
+extern Counter eventChanges;          // By change type
+extern Gauge cycleEventChanges;       // By change type, changes made by the last fetch cycle
+extern Histogram eventsLockWait;
+extern Histogram eventsLockHold;
+extern Histogram requestSeconds;      // By API path and filter
+
+// Status classes of fetch responses, "failed" when no response was received
+enum class FetchStatus : std::uint8_t {
+  Success,        // 2xx
+  Redirect,       // 3xx
+  ClientError,    // 4xx
+  ServerError,    // 5xx
+  Failed
+};
+constexpr std::size_t FETCH_STATUS_COUNT{ static_cast<std::size_t>(FetchStatus::Failed) + 1 };
+FetchStatus toFetchStatus(long httpStatus);
+
+// Endpoints and filter kinds API latency is labelled with
+enum class RequestPath : std::uint8_t {
+  Events,
+  EventsGeoJSON,
+  EventsChanges,
+  EventsHistory,
+  EventsStream,
+  EventsSocket,
+  Incidents,
+  Cameras,
+  Status,
+  Metrics,
+  Other
+};
+constexpr std::size_t REQUEST_PATH_COUNT{ static_cast<std::size_t>(RequestPath::Other) + 1 };
+RequestPath toRequestPath(std::string_view path);
+
+enum class RequestFilter : std::uint8_t {
+  None,
+  Region,
+  Source,
+  RegionSource,
+  BoundingBox,
+  Radius,
+  Other           // Any other parameters only
+};
+constexpr std::size_t REQUEST_FILTER_COUNT{ static_cast<std::size_t>(RequestFilter::Other) + 1 };
+// Classify a query by its most selective filter
+RequestFilter toRequestFilter(const std::vector<std::pair<std::string, std::string>>& queryParams);
+
+// Series of requestSeconds for a path and filter
+constexpr std::size_t requestSeries(RequestPath path, RequestFilter filter) {
+  return static_cast<std::size_t>(path) * REQUEST_FILTER_COUNT + static_cast<std::size_t>(filter);
+}
+
+} // namespace Metrics
+
+#endif
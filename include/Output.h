@@ -22,6 +22,8 @@ enum class LogLevel {
 std::string toString(const LogLevel& level);
 bool createDirIfMissing(const std::string& filePath);
 void clearConsole();
+// Current resident set size of the process in kB (0 if unavailable)
+std::size_t residentMemoryKB();
 
 class Logger {
 private:
@@ -0,0 +1,42 @@
+#include "Arena.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+
+namespace Arena {
+
+namespace {
+
+// Smallest initial buffer for a new source
+constexpr std::size_t MIN_ARENA_SIZE{ 64 * 1024 };
+
+thread_local std::pmr::memory_resource* current{ nullptr };
+
+} // namespace
+
+std::pmr::memory_resource* resource() {
+  return current ? current : std::pmr::get_default_resource();
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+  allocated += bytes;
+  return upstream->allocate(bytes, alignment);
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+  upstream->deallocate(p, bytes, alignment);
+}
+
+Cycle::Cycle(std::size_t& hint)
+: buffer{ std::max(hint, MIN_ARENA_SIZE), &counter }, previous{ current }, sizeHint{ hint }
+{
+  current = &buffer;
+}
+
+Cycle::~Cycle() {
+  current = previous;
+  // Remember the largest cycle so the next one starts with a single buffer big enough for it
+  sizeHint = std::max(sizeHint, counter.total());
+}
+
+} // namespace Arena
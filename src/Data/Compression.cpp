@@ -0,0 +1,123 @@
+#include "Compression.h"
+#include "DataUtils.h"
+#include "Output.h"
+#include <cstdlib>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <zlib.h>
+#ifdef TRAFFIC_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace Compression {
+
+namespace {
+
+// Compress into a gzip container (zlib with a gzip header and trailer)
+std::optional<std::string> gzip(std::string_view data) {
+  z_stream stream{};
+  if(deflateInit2(&stream, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return std::nullopt;
+  std::string output(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = static_cast<uInt>(output.size());
+  int result = deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  if(result != Z_STREAM_END)
+    return std::nullopt;
+  return output;
+}
+
+#ifdef TRAFFIC_HAVE_BROTLI
+std::optional<std::string> brotli(std::string_view data) {
+  std::size_t size = BrotliEncoderMaxCompressedSize(data.size());
+  if(size == 0)
+    return std::nullopt;
+  std::string output(size, '\0');
+  if(!BrotliEncoderCompress(BROTLI_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, data.size(),
+                            reinterpret_cast<const std::uint8_t*>(data.data()), &size, reinterpret_cast<std::uint8_t*>(output.data())))
+    return std::nullopt;
+  output.resize(size);
+  return output;
+}
+#endif
+
+// Whether an encoding was compiled in
+bool supported(Encoding encoding) {
+#ifdef TRAFFIC_HAVE_BROTLI
+  (void)encoding;
+  return true;
+#else
+  return encoding != Encoding::Brotli;
+#endif
+}
+
+} // namespace
+
+std::string_view toString(Encoding encoding) {
+  switch(encoding) {
+    case Encoding::Gzip:
+      return "gzip";
+    case Encoding::Brotli:
+      return "br";
+    default:
+      return "";
+  }
+}
+
+// Entries look like "gzip", "br;q=0.8" or "*;q=0", an encoding is acceptable unless its weight is 0
+// Among acceptable encodings brotli is preferred, it is noticeably smaller on JSON
+Encoding negotiate(const std::string& acceptEncoding) {
+  std::optional<bool> gzipAllowed, brotliAllowed;
+  bool anyAllowed{ false };
+  std::stringstream ss(acceptEncoding);
+  std::string entry;
+  // Elements delimited by ','
+  while(std::getline(ss, entry, ',')) {
+    std::string coding = entry.substr(0, entry.find(';'));
+    trim(coding);
+    bool allowed{ true };
+    auto weight = entry.find("q=");
+    if(weight != std::string::npos)
+      allowed = std::strtod(entry.c_str() + weight + 2, nullptr) > 0.0;
+    if(coding == "gzip" || coding == "x-gzip")
+      gzipAllowed = allowed;
+    else if(coding == "br")
+      brotliAllowed = allowed;
+    else if(coding == "*")
+      anyAllowed = allowed;
+  }
+  if(supported(Encoding::Brotli) && brotliAllowed.value_or(anyAllowed))
+    return Encoding::Brotli;
+  if(gzipAllowed.value_or(anyAllowed))
+    return Encoding::Gzip;
+  return Encoding::Identity;
+}
+
+std::optional<std::string> compress(std::string_view data, Encoding encoding) {
+  if(data.size() < COMPRESSION_MIN_BYTES || !supported(encoding))
+    return std::nullopt;
+  std::optional<std::string> output;
+  switch(encoding) {
+    case Encoding::Gzip:
+      output = gzip(data);
+      break;
+#ifdef TRAFFIC_HAVE_BROTLI
+    case Encoding::Brotli:
+      output = brotli(data);
+      break;
+#endif
+    default:
+      return std::nullopt;
+  }
+  if(!output)
+    Output::logger.log(Output::LogLevel::WARN, "REST API", "Failed to compress response (" + std::string(toString(encoding)) + ")");
+  return output;
+}
+
+} // namespace Compression
@@ -8,6 +8,12 @@
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numbers>
 #include <regex>
 #include <chrono>
 #include <curl/curl.h>
@@ -15,16 +21,28 @@
 #include <rapidxml.hpp>
 #include <iconv.h>
 
-// Remove leading and trailing whitespace from a string
-void trim(std::string& str) {
+namespace {
+// Shared by the heap and arena string overloads
+template<typename String>
+void trimString(String& str) {
   // Remove leading space if present
   str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) { return !std::isspace(ch); }));
   // Remove trailing space if present
   str.erase(std::find_if(str.rbegin(), str.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), str.end());
 }
+} // namespace
+
+// Remove leading and trailing whitespace from a string
+void trim(std::string& str) {
+  trimString(str);
+}
+
+void trim(std::pmr::string& str) {
+  trimString(str);
+}
 
 // Helper function to remove spaces and special characters from a string
-std::string sanitizeString(const std::string& input) {
+std::string sanitizeString(std::string_view input) {
   std::string result;
   for (char c : input) {
     if (std::isalnum(c)) {
@@ -80,10 +98,10 @@ namespace cURL {
 // Write the header data
 size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata) {
   size_t totalSize{ size * nitems };
-  std::vector<std::string>* headers = static_cast<std::vector<std::string>*>(userdata);
+  Headers* headers = static_cast<Headers*>(userdata);
 
-  std::string header(buffer, totalSize);
-  headers->push_back(header);
+  // Construct in place with the vector's arena allocator
+  headers->emplace_back(buffer, totalSize);
 
   return totalSize;
 }
@@ -96,9 +114,9 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* out
 }
 
 // Fetch a data string from a remote source
-std::tuple<Result, std::string, std::vector<std::string>> getData(const std::string& url, Handle& curl){
-  std::string responseData;         // Create a string to hold the data
-  std::vector<std::string> headers; // Create a vector to hold the response headers
+std::tuple<Result, std::string, Headers> getData(const std::string& url, Handle& curl){
+  std::string responseData;                 // Create a string to hold the data
+  Headers headers{ Arena::resource() };     // Create a vector to hold the response headers
   
   // Check for successful initialization
   if(!curl) {
@@ -138,13 +156,13 @@ std::tuple<Result, std::string, std::vector<std::string>> getData(const std::str
     else
       return { Result::REQUEST_FAILED, "", {} };
   }
-  return { Result::SUCCESS, responseData, headers };
+  return { Result::SUCCESS, std::move(responseData), std::move(headers) };
 }
 
 // POST data to a remote endpoint
-std::tuple<Result, std::string, std::vector<std::string>> postData(const std::string& url, const std::string& postData, Handle& curl) {
-  std::string responseData;         // Create a string to hold the data
-  std::vector<std::string> headers; // Create a vector to hold the response headers
+std::tuple<Result, std::string, Headers> postData(const std::string& url, const std::string& postData, Handle& curl) {
+  std::string responseData;                 // Create a string to hold the data
+  Headers headers{ Arena::resource() };     // Create a vector to hold the response headers
   
   // Check for successful initialization
   if(!curl) {
@@ -188,11 +206,56 @@ std::tuple<Result, std::string, std::vector<std::string>> postData(const std::st
     else
       return { Result::REQUEST_FAILED, "", {} };
   }
-  return { Result::SUCCESS, responseData, headers };
+  return { Result::SUCCESS, std::move(responseData), std::move(headers) };
+}
+
+// Pass each chunk straight to the caller
+size_t StreamCallback(void* contents, size_t size, size_t nmemb, void* userdata) {
+  size_t totalSize{ size * nmemb };
+  auto& onChunk = *static_cast<const std::function<void(std::string_view)>*>(userdata);
+  onChunk(std::string_view(static_cast<const char*>(contents), totalSize));
+  return totalSize;
+}
+
+// Stream a response from a remote source
+Result streamData(const std::string& url, Handle& curl, const std::function<void(std::string_view)>& onChunk) {
+  // Check for successful initialization
+  if(!curl) {
+    Output::logger.log(Output::LogLevel::ERROR, "cURL", "Failed to initialize cURL");
+    return Result::INIT_FAILED;
+  }
+
+  // Set cURL options
+  curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, StreamCallback);
+  curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &onChunk);
+  curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 60L); // Large lists take longer than the event feeds
+  curl_easy_setopt(curl.get(), CURLOPT_SSL_VERIFYPEER, 0L);
+  curl_easy_setopt(curl.get(), CURLOPT_ACCEPT_ENCODING, ""); // Let the server compress the body
+
+  // Retrieve the data
+  CURLcode res = curl_easy_perform(curl.get());
+
+  // Check for errors
+  if(res != CURLE_OK) {
+    std::string err = curl_easy_strerror(res);
+    std::string errMsg = "Error streaming data (" + err + ")";
+    Output::logger.log(Output::LogLevel::WARN, "cURL", errMsg);
+
+    if(res == CURLE_UNSUPPORTED_PROTOCOL)
+      return Result::UNSUPPORTED_PROTOCOL;
+    else if(res == CURLE_URL_MALFORMAT)
+      return Result::BAD_URL;
+    else if(res == CURLE_OPERATION_TIMEDOUT)
+      return Result::TIMEOUT;
+    else
+      return Result::REQUEST_FAILED;
+  }
+  return Result::SUCCESS;
 }
 
 // Extract the content-type header from the response
-std::string getContentType(const std::vector<std::string>& headers) {
+std::string getContentType(const Headers& headers) {
   // Iterate through each header
   for(const auto& header : headers) {
     // Check for the "Content-Type" header
@@ -201,7 +264,7 @@ std::string getContentType(const std::vector<std::string>& headers) {
       size_t pos = header.find(":");
       // Check if the key has a value
       if(pos != std::string::npos) {
-        return header.substr(pos + 1);  // Ectract the value that follows the ":"
+        return std::string(header.substr(pos + 1));  // Ectract the value that follows the ":"
       }
     }
   }
@@ -216,11 +279,11 @@ Json::Value parseData(const std::string& jsonData) {
   // Set up Json parsing objects
   Json::CharReaderBuilder builder;
   Json::Value root;                 // Root node of the parsed objects
-  std::istringstream data(jsonData);
   std::string errs;                 // Hold errors in a string
 
-  // Parse the string into the root Value object
-  if(!Json::parseFromStream(builder, data, &root, &errs)) {
+  // Parse the string in place into the root Value object, without copying it into a stream
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  if(!reader->parse(jsonData.data(), jsonData.data() + jsonData.size(), &root, &errs)) {
     // If initial parsing fails, send an error message
     std::string errMsg = "Parsing error (\"" + errs + "\")";
     Output::logger.log(Output::LogLevel::WARN, "JSON", errMsg);
@@ -230,8 +293,335 @@ Json::Value parseData(const std::string& jsonData) {
   Output::logger.log(Output::LogLevel::INFO, "JSON", "Successfully parsed data stream");
   return root; // Return the parsed root of objects
 }
+
+// Track string and nesting state across chunks, copying only the bytes of nested elements
+void ArraySplitter::feed(std::string_view chunk, const std::function<void(std::string_view)>& onElement) {
+  for(char c : chunk) {
+    if(depth >= 2)
+      element += c;
+    if(inString) {
+      if(escaped)
+        escaped = false;
+      else if(c == '\\')
+        escaped = true;
+      else if(c == '"')
+        inString = false;
+      continue;
+    }
+    switch(c) {
+      case '"':
+        inString = true;
+        break;
+      case '{':
+      case '[':
+        // Start of an element, keep its opening bracket
+        if(++depth == 1)
+          isArray = c == '[';
+        else if(depth == 2)
+          element = c;
+        break;
+      case '}':
+      case ']':
+        if(--depth == 1 && isArray)
+          onElement(element);
+        else if(depth == 0)
+          closed = true;
+        if(depth <= 1)
+          element.clear();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+namespace {
+
+// Length of the UTF-8 sequence starting at text[i], 0 if it is malformed, overlong or a surrogate
+std::size_t sequenceLength(std::string_view text, std::size_t i) {
+  auto byte = [&text](std::size_t at){ return static_cast<unsigned char>(text[at]); };
+  auto continuation = [&](std::size_t at, unsigned char low = 0x80, unsigned char high = 0xBF){
+    return at < text.size() && byte(at) >= low && byte(at) <= high;
+  };
+  unsigned char lead = byte(i);
+  if(lead >= 0xC2 && lead <= 0xDF)
+    return continuation(i + 1) ? 2 : 0;
+  if(lead >= 0xE0 && lead <= 0xEF) {
+    bool second = lead == 0xE0 ? continuation(i + 1, 0xA0) : lead == 0xED ? continuation(i + 1, 0x80, 0x9F) : continuation(i + 1);
+    return second && continuation(i + 2) ? 3 : 0;
+  }
+  if(lead >= 0xF0 && lead <= 0xF4) {
+    bool second = lead == 0xF0 ? continuation(i + 1, 0x90) : lead == 0xF4 ? continuation(i + 1, 0x80, 0x8F) : continuation(i + 1);
+    return second && continuation(i + 2) && continuation(i + 3) ? 4 : 0;
+  }
+  return 0;
+}
+
+} // namespace
+
+// Add a comma between values, except directly after a key
+void Writer::separate() {
+  if(afterKey) {
+    afterKey = false;
+    return;
+  }
+  if(!hasItems.empty()) {
+    if(hasItems.back())
+      buffer += ',';
+    hasItems.back() = true;
+  }
+}
+
+// Quote a string, escaping control characters and replacing invalid UTF-8 with U+FFFD
+void Writer::escape(std::string_view text) {
+  static constexpr char hex[]{ "0123456789abcdef" };
+  buffer += '"';
+  std::size_t i{ 0 };
+  while(i < text.size()) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if(c >= 0x80) {
+      std::size_t length = sequenceLength(text, i);
+      if(length)
+        buffer.append(text.substr(i, length));
+      else
+        buffer += "\\ufffd";
+      i += length ? length : 1;
+      continue;
+    }
+    switch(c) {
+      case '"':  buffer += "\\\""; break;
+      case '\\': buffer += "\\\\"; break;
+      case '\b': buffer += "\\b"; break;
+      case '\f': buffer += "\\f"; break;
+      case '\n': buffer += "\\n"; break;
+      case '\r': buffer += "\\r"; break;
+      case '\t': buffer += "\\t"; break;
+      default:
+        if(c < 0x20) {
+          buffer += "\\u00";
+          buffer += hex[c >> 4];
+          buffer += hex[c & 0xF];
+        } else {
+          buffer += static_cast<char>(c);
+        }
+    }
+    i++;
+  }
+  buffer += '"';
+}
+
+Writer& Writer::beginObject() {
+  separate();
+  buffer += '{';
+  hasItems.push_back(false);
+  return *this;
+}
+
+Writer& Writer::endObject() {
+  buffer += '}';
+  hasItems.pop_back();
+  flushIfFull();
+  return *this;
+}
+
+Writer& Writer::beginArray() {
+  separate();
+  buffer += '[';
+  hasItems.push_back(false);
+  return *this;
+}
+
+Writer& Writer::endArray() {
+  buffer += ']';
+  hasItems.pop_back();
+  flushIfFull();
+  return *this;
+}
+
+Writer& Writer::key(std::string_view name) {
+  separate();
+  escape(name);
+  buffer += ':';
+  afterKey = true;
+  return *this;
+}
+
+Writer& Writer::value(std::string_view text) {
+  separate();
+  escape(text);
+  flushIfFull();
+  return *this;
+}
+
+// Same output as "%.6g", with ".0" added to whole numbers so they still read back as doubles
+Writer& Writer::value(double number) {
+  separate();
+  if(!std::isfinite(number)) {
+    buffer += "null";
+    return *this;
+  }
+  char digits[32];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), number, std::chars_format::general, 6);
+  std::string_view text(digits, static_cast<std::size_t>(end - digits));
+  buffer += text;
+  if(text.find_first_of(".e") == std::string_view::npos)
+    buffer += ".0";
+  return *this;
+}
+
+Writer& Writer::value(std::int64_t number) {
+  separate();
+  char digits[24];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), number);
+  buffer.append(digits, end);
+  return *this;
+}
+
+Writer& Writer::value(std::uint64_t number) {
+  separate();
+  char digits[24];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), number);
+  buffer.append(digits, end);
+  return *this;
+}
+
+Writer& Writer::value(bool flag) {
+  separate();
+  buffer += flag ? "true" : "false";
+  return *this;
+}
+
+Writer& Writer::null() {
+  separate();
+  buffer += "null";
+  return *this;
+}
+
+Writer& Writer::raw(std::string_view json) {
+  separate();
+  buffer += json;
+  flushIfFull();
+  return *this;
+}
+
+void Writer::flush() {
+  if(!sink || buffer.empty())
+    return;
+  sink->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  buffer.clear();
+}
 } // namespace JSON
 
+namespace MsgPack {
+
+void Writer::header(unsigned char type, std::uint64_t value, int bytes) {
+  buffer += static_cast<char>(type);
+  for(int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+    buffer += static_cast<char>((value >> shift) & 0xFF);
+}
+
+void Writer::length(std::size_t size, unsigned char type8, unsigned char type16, unsigned char type32) {
+  if(size <= 0xFF && type8 != 0)
+    header(type8, size, 1);
+  else if(size <= 0xFFFF)
+    header(type16, size, 2);
+  else
+    header(type32, size, 4);
+}
+
+Writer& Writer::map(std::size_t entries) {
+  if(entries < 16)
+    buffer += static_cast<char>(0x80 | entries);
+  else
+    length(entries, 0, 0xDE, 0xDF);   // No 8 bit form for containers
+  return *this;
+}
+
+Writer& Writer::array(std::size_t items) {
+  if(items < 16)
+    buffer += static_cast<char>(0x90 | items);
+  else
+    length(items, 0, 0xDC, 0xDD);
+  return *this;
+}
+
+// Strings are written as they are when valid UTF-8, the usual case, otherwise invalid bytes become U+FFFD
+Writer& Writer::value(std::string_view text) {
+  std::size_t size{ 0 };
+  bool valid{ true };
+  for(std::size_t i = 0; i < text.size();) {
+    std::size_t step = static_cast<unsigned char>(text[i]) < 0x80 ? 1 : JSON::sequenceLength(text, i);
+    valid = valid && step != 0;
+    size += step ? step : 3;
+    i += step ? step : 1;
+  }
+  if(size < 32)
+    buffer += static_cast<char>(0xA0 | size);
+  else
+    length(size, 0xD9, 0xDA, 0xDB);
+  if(valid) {
+    buffer += text;
+    return *this;
+  }
+  for(std::size_t i = 0; i < text.size();) {
+    std::size_t step = static_cast<unsigned char>(text[i]) < 0x80 ? 1 : JSON::sequenceLength(text, i);
+    if(step)
+      buffer.append(text.substr(i, step));
+    else
+      buffer += "\xEF\xBF\xBD";
+    i += step ? step : 1;
+  }
+  return *this;
+}
+
+Writer& Writer::value(double number) {
+  std::uint64_t bits{ 0 };
+  std::memcpy(&bits, &number, sizeof(bits));
+  header(0xCB, bits, 8);
+  return *this;
+}
+
+Writer& Writer::value(std::int64_t number) {
+  if(number >= 0)
+    return value(static_cast<std::uint64_t>(number));
+  if(number >= -32)
+    buffer += static_cast<char>(number);    // Negative fixint
+  else if(number >= INT8_MIN)
+    header(0xD0, static_cast<std::uint64_t>(number), 1);
+  else if(number >= INT16_MIN)
+    header(0xD1, static_cast<std::uint64_t>(number), 2);
+  else if(number >= INT32_MIN)
+    header(0xD2, static_cast<std::uint64_t>(number), 4);
+  else
+    header(0xD3, static_cast<std::uint64_t>(number), 8);
+  return *this;
+}
+
+Writer& Writer::value(std::uint64_t number) {
+  if(number < 0x80)
+    buffer += static_cast<char>(number);    // Positive fixint
+  else if(number <= UINT8_MAX)
+    header(0xCC, number, 1);
+  else if(number <= UINT16_MAX)
+    header(0xCD, number, 2);
+  else if(number <= UINT32_MAX)
+    header(0xCE, number, 4);
+  else
+    header(0xCF, number, 8);
+  return *this;
+}
+
+Writer& Writer::value(bool flag) {
+  buffer += static_cast<char>(flag ? 0xC3 : 0xC2);
+  return *this;
+}
+
+Writer& Writer::null() {
+  buffer += static_cast<char>(0xC0);
+  return *this;
+}
+} // namespace MsgPack
+
 namespace XML {
 // Parse events from an XML data stream
 // NOTE: Use a unique ptr to ensure proper memory manegement here
@@ -251,7 +641,7 @@ std::unique_ptr<rapidxml::xml_document<>> parseData(std::string& xmlData) {
 
 // Create a unique key for the event object
 void HTML::Event::createID() {
-  std::string id{"ONGOV-"};
+  std::pmr::string id{ "ONGOV-", Arena::resource() };
   // Start with the region code
   id += sanitizeString(region);
   // Add date component
@@ -309,6 +699,28 @@ bool BoundingBox::contains(const Location& coordinate) const {
   return false;
 }
 
+// Haversine distance between two coordinates
+double distanceKm(const Location& from, const Location& to) {
+  constexpr double earthRadiusKm{ 6371.0 };
+  constexpr double toRadians{ std::numbers::pi / 180.0 };
+  double dLat = (to.latitude - from.latitude) * toRadians;
+  double dLong = (to.longitude - from.longitude) * toRadians;
+  double a = std::sin(dLat / 2) * std::sin(dLat / 2)
+           + std::cos(from.latitude * toRadians) * std::cos(to.latitude * toRadians) * std::sin(dLong / 2) * std::sin(dLong / 2);
+  return earthRadiusKm * 2 * std::atan2(std::sqrt(a), std::sqrt(1 - a));
+}
+
+// Create a box around a point which contains every location within the radius
+// The box is clamped to valid coordinates, so grid cells computed from it stay in range
+BoundingBox boundingBox(const Location& center, double radiusKm) {
+  constexpr double kmPerDegree{ 111.32 };
+  double latDelta = radiusKm / kmPerDegree;
+  // Longitude degrees shrink towards the poles, guard against dividing by zero
+  double longDelta = radiusKm / (kmPerDegree * std::max(std::cos(center.latitude * std::numbers::pi / 180.0), 0.01));
+  return { std::clamp(center.longitude - longDelta, -180.0, 180.0), std::clamp(center.longitude + longDelta, -180.0, 180.0),
+           std::clamp(center.latitude + latDelta, -90.0, 90.0), std::clamp(center.latitude - latDelta, -90.0, 90.0) };
+}
+
 std::ostream &operator<<(std::ostream &out, const Location &location) {
   out << "Coordinate [ " << location.latitude << ", " << location.longitude << " ]";
   return out;
@@ -329,6 +741,15 @@ std::time_t currentTime_t() {
   return time;
 }
 
+// Truncate a time point to whole seconds since epoch
+std::int64_t toEpoch(const system_clock::time_point& time) {
+  return duration_cast<seconds>(time.time_since_epoch()).count();
+}
+
+system_clock::time_point fromEpoch(std::int64_t sinceEpoch) {
+  return system_clock::time_point{ seconds(sinceEpoch) };
+}
+
 // Create a local formatted time string for printing from a time point object
 std::tm toLocalPrint(const system_clock::time_point& time) {
   auto utcTime = system_clock::to_time_t(time);
@@ -0,0 +1,549 @@
+#include "EventStream.h"
+#include "DataUtils.h"
+#include "Output.h"
+#include "RestAPI.h"
+#include "Traffic.h"
+#include <Poco/Timespan.h>
+#include <algorithm>
+#include <climits>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+
+namespace RestAPI {
+
+EventStream eventStream;
+
+namespace {
+
+// WebSocket opcodes (RFC 6455)
+constexpr std::uint8_t WS_TEXT{ 0x1 };
+constexpr std::uint8_t WS_CLOSE{ 0x8 };
+constexpr std::uint8_t WS_PING{ 0x9 };
+constexpr std::uint8_t WS_PONG{ 0xA };
+
+// WebSocket close status codes
+constexpr std::uint16_t WS_CLOSE_PROTOCOL_ERROR{ 1002 };
+constexpr std::uint16_t WS_CLOSE_UNSUPPORTED{ 1003 };
+constexpr std::uint16_t WS_CLOSE_TOO_BIG{ 1009 };
+
+// Frame a JSON payload as a Server-Sent Event, the sequence lets a reconnecting client resume
+// NOTE: Minified JSON never contains a raw newline, so the payload fits a single data line
+void appendEvent(std::string& out, std::string_view type, std::uint64_t sequence, std::string_view data) {
+  out += "event: ";
+  out += type;
+  out += "\nid: ";
+  out += std::to_string(sequence);
+  out += "\ndata: ";
+  out += data;
+  out += "\n\n";
+}
+
+// Frame a payload as a single unfragmented WebSocket message, frames from the server are never masked
+void appendFrame(std::string& out, std::uint8_t opcode, std::string_view payload) {
+  out += static_cast<char>(0x80 | opcode);
+  std::uint64_t length = payload.size();
+  if(length < 126) {
+    out += static_cast<char>(length);
+  } else if(length <= 0xFFFF) {
+    out += static_cast<char>(126);
+    out += static_cast<char>(length >> 8);
+    out += static_cast<char>(length & 0xFF);
+  } else {
+    out += static_cast<char>(127);
+    for(int shift = 56; shift >= 0; shift -= 8)
+      out += static_cast<char>((length >> shift) & 0xFF);
+  }
+  out += payload;
+}
+
+// Serialize a change in the same shape as /events/changes
+std::string changeJSON(const Traffic::Change& change, Traffic::ChangeType type, const Traffic::Event* event) {
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.key("seq").value(change.sequence);
+  writer.key("type").value(Traffic::toString(type));
+  writer.key("id").value(change.id);
+  writer.key("source").nullable(Traffic::sourceName(change.source));
+  if(event)
+    writer.key("event").raw(event->getJSONFragment());
+  writer.endObject();
+  return writer.release();
+}
+
+// Messages look like {"type": "subscribe", "region": ..., "source": ..., "bbox": "west,south,east,north"}
+// Omitted filters match everything
+std::optional<Subscription> parseSubscriptionMessage(const std::string& text) {
+  Json::Value message = JSON::parseData(text);
+  if(!message.isObject() || !message["type"].isString() || message["type"].asString() != "subscribe")
+    return std::nullopt;
+  std::vector<std::pair<std::string, std::string>> params;
+  for(const std::string& name : message.getMemberNames()) {
+    if(name == "type")
+      continue;
+    if(!message[name].isString())
+      return std::nullopt;
+    params.emplace_back(name, message[name].asString());
+  }
+  return parseSubscription(params);
+}
+
+} // namespace
+
+struct EventStream::Outgoing {
+  std::uint64_t sequence;
+  Traffic::DataSource source;
+  std::optional<Placement> current;         // Unset once deleted
+  std::optional<Placement> previous;        // Unset if the event was never streamed
+  std::string upsertJSON;                   // Insert or update, empty for deletes
+  std::string removeJSON;
+  std::string upsertEvent;                  // The same, framed as Server-Sent Events
+  std::string removeEvent;
+};
+
+std::optional<Subscription> parseSubscription(const std::vector<std::pair<std::string, std::string>>& params) {
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : params) {
+    if(key != "region" && key != "source" && key != "bbox")
+      return std::nullopt;
+  }
+  Subscription subscription;
+  if(auto regionParam = findQueryParam(params, "region"))
+    subscription.region = Traffic::toRegion(*regionParam);
+  if(auto sourceParam = findQueryParam(params, "source"))
+    subscription.source = Traffic::toSource(*sourceParam);
+  if(auto boxParam = findQueryParam(params, "bbox")) {
+    auto box = parseBoundingBox(*boxParam);
+    if(!box)
+      return std::nullopt;
+    subscription.box.emplace(*box);
+  }
+  return subscription;
+}
+
+EventStream::~EventStream() {
+  stop();
+}
+
+EventStream::Placement EventStream::placementOf(const Traffic::Event& event) {
+  return { event.getRegion(), event.hasLocation() ? std::optional(event.getLocation()) : std::nullopt };
+}
+
+EventStream::Outgoing EventStream::makeOutgoing(const Traffic::EventStore& store, const Traffic::Change& change, std::optional<Placement> previous) {
+  Outgoing outgoing{ change.sequence, change.source, std::nullopt, std::move(previous), {}, {}, {}, {} };
+  const Traffic::Event* event = change.type == Traffic::ChangeType::Delete ? nullptr : store.find(change.source, change.id);
+  if(event) {
+    outgoing.current = placementOf(*event);
+    outgoing.upsertJSON = changeJSON(change, change.type, event);
+    appendEvent(outgoing.upsertEvent, Traffic::toString(change.type), change.sequence, outgoing.upsertJSON);
+  }
+  outgoing.removeJSON = changeJSON(change, Traffic::ChangeType::Delete, nullptr);
+  appendEvent(outgoing.removeEvent, Traffic::toString(Traffic::ChangeType::Delete), change.sequence, outgoing.removeJSON);
+  return outgoing;
+}
+
+bool EventStream::queueChange(Client& client, const Outgoing& change) {
+  // A client can be reached through both the old and new position of an event
+  if(client.closing || client.visited == change.sequence || change.sequence <= client.from)
+    return false;
+  client.visited = change.sequence;
+  const Subscription& filter = client.subscription;
+  bool upsert = change.current && filter.matches(change.current->region, change.source, change.current->location);
+  if(!upsert) {
+    // An event never streamed may still be in the client's snapshot, so only its source can rule it out
+    bool held = change.previous ? filter.matches(change.previous->region, change.source, change.previous->location)
+                                : !filter.source || *filter.source == change.source;
+    if(!held)
+      return false;
+  }
+  if(client.protocol == StreamProtocol::ServerSentEvents) {
+    client.pending += upsert ? change.upsertEvent : change.removeEvent;
+    return false;
+  }
+  bool started = client.batch.empty();
+  if(!started)
+    client.batch += ',';
+  client.batch += upsert ? change.upsertJSON : change.removeJSON;
+  return started;
+}
+
+std::string EventStream::snapshotMessage(const Traffic::EventStore& store, const Client& client) {
+  const Subscription& filter = client.subscription;
+  std::vector<const Traffic::Event*> events = filter.box ? store.selectWithin(*filter.box, filter.region, filter.source)
+                                                         : store.select(filter.region, filter.source);
+  JSON::Writer writer;
+  std::string message;
+  if(client.protocol == StreamProtocol::WebSocket) {
+    writer.beginObject();
+    writer.key("type").value("snapshot");
+    writer.key("sequence").value(store.currentSequence());
+    writer.key("events").beginArray();
+    for(const Traffic::Event* event : events)
+      writer.raw(event->getJSONFragment());
+    writer.endArray();
+    writer.endObject();
+    appendFrame(message, WS_TEXT, writer.release());
+  } else {
+    writer.beginArray();
+    for(const Traffic::Event* event : events)
+      writer.raw(event->getJSONFragment());
+    writer.endArray();
+    appendEvent(message, "snapshot", store.currentSequence(), writer.release());
+  }
+  return message;
+}
+
+void EventStream::finishBatch(Client& client, std::uint64_t sequence) {
+  if(client.batch.empty())
+    return;
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.key("type").value("changes");
+  writer.key("sequence").value(sequence);
+  writer.key("changes").beginArray();
+  writer.raw(client.batch);
+  writer.endArray();
+  writer.endObject();
+  appendFrame(client.pending, WS_TEXT, writer.release());
+  client.batch.clear();
+}
+
+void EventStream::stopReading(Client& client) {
+  if(readers.erase(client.socket) && pollSet.has(client.socket))
+    pollSet.remove(client.socket);
+  index.remove(&client);
+  std::erase(fresh, &client);
+}
+
+void EventStream::closeClient(Client& client, std::uint16_t status) {
+  if(client.closing)
+    return;
+  const char payload[2]{ static_cast<char>(status >> 8), static_cast<char>(status & 0xFF) };
+  appendFrame(client.pending, WS_CLOSE, std::string_view(payload, sizeof(payload)));
+  client.closing = true;
+  stopReading(client);
+}
+
+void EventStream::release(Client& client) {
+  stopReading(client);
+  try {
+    client.socket.close();
+  } catch(const std::exception&) {}
+}
+
+void EventStream::start() {
+  std::lock_guard<std::mutex> lock(clientsMutex);
+  if(writer.joinable())
+    return;
+  stopping = false;
+  writer = std::thread(&EventStream::writeLoop, this);
+  reader = std::thread(&EventStream::readLoop, this);
+}
+
+void EventStream::stop() {
+  {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  if(reader.joinable())
+    reader.join();
+  if(writer.joinable())
+    writer.join();
+}
+
+void EventStream::subscribe(Poco::Net::StreamSocket&& socket, StreamProtocol protocol, const Subscription& subscription,
+                            std::optional<std::uint64_t> lastSequence) {
+  auto client = std::make_unique<Client>();
+  client->socket = std::move(socket);
+  client->protocol = protocol;
+  client->subscription = subscription;
+  client->socket.setBlocking(false);
+  {
+    std::lock_guard<Metrics::TimedMutex> eventsLock(Traffic::eventsMutex);
+    const Traffic::EventStore& store = Traffic::mapEvents;
+    std::optional<Traffic::ChangeSet> resumed;
+    if(lastSequence) {
+      resumed = store.changesSince(*lastSequence);
+      if(resumed->reset)
+        resumed.reset();
+    }
+    if(resumed) {
+      // Replay only what the client missed, where it last saw each event is unknown so
+      // events now outside its filters are always deleted
+      for(const Traffic::Change* change : resumed->changes)
+        queueChange(*client, makeOutgoing(store, *change, std::nullopt));
+      finishBatch(*client, resumed->sequence);
+    } else {
+      client->pending = snapshotMessage(store, *client);
+    }
+    client->from = store.currentSequence();
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    Client* added = client.get();
+    index.insert(added, added->subscription);
+    fresh.push_back(added);
+    if(protocol == StreamProtocol::WebSocket) {
+      readers.emplace(added->socket, added);
+      pollSet.add(added->socket, Poco::Net::PollSet::POLL_READ);
+    }
+    clients.push_back(std::move(client));
+  }
+  wakeup.notify_all();
+}
+
+void EventStream::resubscribe(const Poco::Net::Socket& socket, const Subscription& subscription) {
+  std::lock_guard<Metrics::TimedMutex> eventsLock(Traffic::eventsMutex);
+  std::lock_guard<std::mutex> lock(clientsMutex);
+  // The client may have closed since its message was read
+  auto found = readers.find(socket);
+  if(found == readers.end())
+    return;
+  Client& client = *found->second;
+  client.subscription = subscription;
+  index.insert(&client, subscription);
+  client.pending += snapshotMessage(Traffic::mapEvents, client);
+  client.from = Traffic::mapEvents.currentSequence();
+  if(std::find(fresh.begin(), fresh.end(), &client) == fresh.end())
+    fresh.push_back(&client);
+}
+
+void EventStream::publish(const Traffic::EventStore& store) {
+  {
+    std::lock_guard<Metrics::TimedMutex> eventsLock(Traffic::eventsMutex);
+    Traffic::ChangeSet changeSet = store.changesSince(streamedSequence);
+    if(changeSet.reset) {
+      // Fell behind the change log (or first run), every client still behind gets a fresh snapshot
+      placements.clear();
+      for(const Traffic::Event* event : store.select(std::nullopt, std::nullopt))
+        placements.emplace(Traffic::EventKey{ event->getSource(), std::string(event->getID()) }, placementOf(*event));
+      std::lock_guard<std::mutex> lock(clientsMutex);
+      for(auto& client : clients) {
+        if(client->closing || client->from >= changeSet.sequence)
+          continue;
+        client->pending += snapshotMessage(store, *client);
+        client->from = changeSet.sequence;
+      }
+      fresh.clear();
+    } else {
+      // Serialize each change once, then queue it for the clients the index finds
+      std::vector<Outgoing> outgoing;
+      outgoing.reserve(changeSet.changes.size());
+      for(const Traffic::Change* change : changeSet.changes) {
+        Traffic::EventKey key{ change->source, change->id };
+        auto known = placements.find(key);
+        std::optional<Placement> previous;
+        if(known != placements.end())
+          previous = known->second;
+        outgoing.push_back(makeOutgoing(store, *change, previous));
+        if(outgoing.back().current)
+          placements.insert_or_assign(std::move(key), *outgoing.back().current);
+        else if(known != placements.end())
+          placements.erase(known);
+      }
+      std::lock_guard<std::mutex> lock(clientsMutex);
+      std::vector<Client*> batched;
+      for(const Outgoing& change : outgoing) {
+        auto consider = [&](Client* client){
+          if(queueChange(*client, change))
+            batched.push_back(client);
+        };
+        if(change.current)
+          index.visitCandidates(change.current->region, change.source, change.current->location, consider);
+        // Only clients which subscribed since the last publish can hold an event that was never streamed
+        if(change.previous)
+          index.visitCandidates(change.previous->region, change.source, change.previous->location, consider);
+        else
+          std::for_each(fresh.begin(), fresh.end(), consider);
+      }
+      for(Client* client : batched)
+        finishBatch(*client, changeSet.sequence);
+      fresh.clear();
+    }
+    streamedSequence = changeSet.sequence;
+  }
+  wakeup.notify_all();
+}
+
+// Frames are parsed from the front of the buffer, a partial frame waits for the next read
+// Messages are small, so fragmented or oversized messages close the connection
+void EventStream::receive(Client& client, std::vector<std::pair<Poco::Net::Socket, Subscription>>& requests) {
+  char chunk[WEBSOCKET_MESSAGE_LIMIT];
+  int length{ 0 };
+  try {
+    length = client.socket.receiveBytes(chunk, static_cast<int>(sizeof(chunk)));
+  } catch(const std::exception&) {
+    length = 0;
+  }
+  if(length < 0)
+    return;     // Nothing to read yet
+  if(length == 0) {
+    // Closed by the peer, nothing more can be delivered
+    client.pending.clear();
+    client.closing = true;
+    stopReading(client);
+    return;
+  }
+  client.received.append(chunk, static_cast<std::size_t>(length));
+
+  std::size_t offset{ 0 };
+  const std::string& data = client.received;
+  auto byte = [&data](std::size_t position){ return static_cast<std::uint8_t>(data[position]); };
+  while(data.size() - offset >= 2) {
+    bool final = byte(offset) & 0x80;
+    std::uint8_t opcode = byte(offset) & 0x0F;
+    bool masked = byte(offset + 1) & 0x80;
+    std::uint64_t payloadLength = byte(offset + 1) & 0x7F;
+    std::size_t header{ 2 };
+    if(payloadLength == 126 || payloadLength == 127) {
+      std::size_t extended = payloadLength == 126 ? 2 : 8;
+      if(data.size() - offset < header + extended)
+        break;
+      payloadLength = 0;
+      for(std::size_t i = 0; i < extended; i++)
+        payloadLength = (payloadLength << 8) | byte(offset + header + i);
+      header += extended;
+    }
+    // Clients must mask every frame, and subscription messages are never fragmented
+    if(!masked || !final) {
+      closeClient(client, WS_CLOSE_PROTOCOL_ERROR);
+      return;
+    }
+    if(payloadLength > WEBSOCKET_MESSAGE_LIMIT) {
+      closeClient(client, WS_CLOSE_TOO_BIG);
+      return;
+    }
+    if(data.size() - offset < header + 4 + payloadLength)
+      break;
+    std::string payload = data.substr(offset + header + 4, static_cast<std::size_t>(payloadLength));
+    for(std::size_t i = 0; i < payload.size(); i++)
+      payload[i] = static_cast<char>(static_cast<std::uint8_t>(payload[i]) ^ byte(offset + header + i % 4));
+    offset += header + 4 + static_cast<std::size_t>(payloadLength);
+
+    switch(opcode) {
+      case WS_TEXT:
+        if(auto subscription = parseSubscriptionMessage(payload))
+          requests.emplace_back(client.socket, std::move(*subscription));
+        else
+          appendFrame(client.pending, WS_TEXT, R"({"type":"error","message":"Invalid subscription"})");
+        break;
+      case WS_PING:
+        appendFrame(client.pending, WS_PONG, payload);
+        break;
+      case WS_PONG:
+        break;
+      case WS_CLOSE:
+        // Answer with the client's status and drop it once sent
+        client.closing = true;
+        appendFrame(client.pending, WS_CLOSE, std::string_view(payload).substr(0, 2));
+        stopReading(client);
+        return;
+      default:
+        closeClient(client, WS_CLOSE_UNSUPPORTED);
+        return;
+    }
+  }
+  client.received.erase(0, offset);
+}
+
+// NOTE: clientsMutex must be held, sends never block so the lock is only held briefly
+bool EventStream::flush() {
+  bool backlog{ false };
+  std::erase_if(clients, [this, &backlog](std::unique_ptr<Client>& client){
+    bool drop = client->pending.size() > STREAM_BUFFER_LIMIT;
+    try {
+      while(!drop && !client->pending.empty()) {
+        int length = static_cast<int>(std::min<std::size_t>(client->pending.size(), INT_MAX));
+        int sent = client->socket.sendBytes(client->pending.data(), length, MSG_NOSIGNAL);
+        if(sent <= 0)
+          break;    // The socket buffer is full, retry on the next pass
+        client->pending.erase(0, static_cast<std::size_t>(sent));
+      }
+    } catch(const std::exception&) {
+      drop = true;  // Closed by the peer
+    }
+    if(drop || (client->closing && client->pending.empty())) {
+      release(*client);
+      return true;
+    }
+    if(!client->pending.empty())
+      backlog = true;
+    return false;
+  });
+  return backlog;
+}
+
+void EventStream::writeLoop() {
+  std::unique_lock<std::mutex> lock(clientsMutex);
+  auto nextHeartbeat = std::chrono::steady_clock::now() + STREAM_HEARTBEAT_INTERVAL;
+  while(!stopping) {
+    if(std::chrono::steady_clock::now() >= nextHeartbeat) {
+      for(auto& client : clients) {
+        if(client->closing)
+          continue;
+        if(client->protocol == StreamProtocol::WebSocket)
+          appendFrame(client->pending, WS_PING, "");
+        else
+          client->pending += ": keepalive\n\n";
+      }
+      nextHeartbeat = std::chrono::steady_clock::now() + STREAM_HEARTBEAT_INTERVAL;
+    }
+    // Retry soon while any socket is full, otherwise sleep until new data or the next heartbeat
+    if(flush())
+      wakeup.wait_for(lock, std::chrono::milliseconds(50));
+    else
+      wakeup.wait_until(lock, nextHeartbeat);
+  }
+  for(auto& client : clients)
+    release(*client);
+  clients.clear();
+}
+
+void EventStream::readLoop() {
+  const Poco::Timespan timeout(0, static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(WEBSOCKET_POLL_INTERVAL).count()));
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(clientsMutex);
+      if(stopping)
+        return;
+      // Polling an empty set returns at once, wait for a WebSocket client instead
+      if(readers.empty()) {
+        wakeup.wait_for(lock, WEBSOCKET_POLL_INTERVAL);
+        continue;
+      }
+    }
+    Poco::Net::PollSet::SocketModeMap ready;
+    try {
+      ready = pollSet.poll(timeout);
+    } catch(const std::exception& e) {
+      Output::logger.log(Output::LogLevel::WARN, "STREAM", std::string("Polling WebSocket clients failed (\"") + e.what() + "\")");
+      continue;
+    }
+    if(ready.empty())
+      continue;
+    std::vector<std::pair<Poco::Net::Socket, Subscription>> requests;
+    {
+      std::lock_guard<std::mutex> lock(clientsMutex);
+      for(const auto& entry : ready) {
+        auto found = readers.find(entry.first);
+        if(found != readers.end())
+          receive(*found->second, requests);
+      }
+    }
+    // Snapshots need the store, which is locked before the clients
+    for(const auto& [socket, subscription] : requests)
+      resubscribe(socket, subscription);
+    wakeup.notify_all();
+  }
+}
+
+std::size_t EventStream::size() {
+  std::lock_guard<std::mutex> lock(clientsMutex);
+  return clients.size();
+}
+
+} // namespace RestAPI
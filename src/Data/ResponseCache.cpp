@@ -0,0 +1,66 @@
+#include "ResponseCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace RestAPI {
+
+ResponseCache responseCache;
+
+// Only the first value of a repeated key is used by the handlers, so a stable sort keeps
+// equivalent requests on the same key
+std::string ResponseCache::makeKey(const std::string& path, std::vector<std::pair<std::string, std::string>> queryParams) {
+  std::stable_sort(queryParams.begin(), queryParams.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+  std::string key{ path };
+  key += '?';
+  for(const auto& [name, value] : queryParams) {
+    key += name;
+    key += '=';
+    key += value;
+    key += '&';
+  }
+  return key;
+}
+
+std::string ResponseCache::makeETag(const std::string& key, std::uint64_t storeVersion, Compression::Encoding encoding) {
+  char tag[64];
+  std::string_view coding = Compression::toString(encoding);
+  int length = std::snprintf(tag, sizeof(tag), "W/\"%llx-%zx%s%.*s\"", static_cast<unsigned long long>(storeVersion),
+                             std::hash<std::string>{}(key), coding.empty() ? "" : "-", static_cast<int>(coding.size()), coding.data());
+  return std::string(tag, static_cast<std::size_t>(length));
+}
+
+ResponseCache::Response ResponseCache::find(const std::string& key, std::uint64_t storeVersion, Compression::Encoding negotiated) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  if(storeVersion != version)
+    return {};
+  auto found = entries.find(key);
+  if(found == entries.end())
+    return {};
+  return found->second[static_cast<std::size_t>(negotiated)];
+}
+
+void ResponseCache::insert(const std::string& key, std::uint64_t storeVersion, Compression::Encoding negotiated, Response response) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  // A request which read an older version finished after a newer one, its body is already stale
+  if(storeVersion < version)
+    return;
+  if(storeVersion > version || (entries.size() >= RESPONSE_CACHE_CAPACITY && !entries.contains(key))) {
+    entries.clear();
+    version = storeVersion;
+  }
+  entries[key][static_cast<std::size_t>(negotiated)] = std::move(response);
+}
+
+std::size_t ResponseCache::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return entries.size();
+}
+
+} // namespace RestAPI
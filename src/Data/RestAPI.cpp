@@ -1,8 +1,16 @@
 #include "RestAPI.h"
 #include "Output.h"
 #include "Traffic.h"
+#include "History.h"
+#include "CameraStore.h"
+#include "Incidents.h"
+#include "EventStore.h"
+#include "ResponseCache.h"
+#include "Compression.h"
+#include "EventStream.h"
+#include "ServerMetrics.h"
+#include "Metrics.h"
 #include "main.h"
-#include <json/json.h>
 
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/HTTPRequestHandler.h>
@@ -10,56 +18,387 @@
 #include <Poco/Net/HTTPResponse.h>
 #include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
 #include <Poco/Net/HTTPServerResponse.h>
 #include <Poco/Net/ServerSocket.h>
 #include <Poco/ThreadPool.h>
 #include <Poco/Logger.h>
 #include <Poco/Util/ServerApplication.h>
 #include <Poco/URI.h>
-#include <json/writer.h>
+#include <Poco/SHA1Engine.h>
+#include <Poco/Base64Encoder.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <thread>
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
 
 namespace RestAPI{
 
 
+namespace {
+
+// Current version of the event store, read without locking so cache hits and 304s never wait on ingestion
+// It is read before serializing, so a cached body may be newer than its version but never older
+std::uint64_t storeVersion() {
+  return Traffic::mapEvents.currentVersion();
+}
+
+// How long clients and proxies may reuse a response before revalidating it
+// Events change at most once per fetch cycle and cameras every 15 minutes
+constexpr int EVENTS_MAX_AGE_SECONDS{ 15 };
+constexpr int CAMERAS_MAX_AGE_SECONDS{ 300 };
+
+// Cache-Control header for a successful response from an endpoint
+std::string cacheControl(const std::string& path) {
+  if(path == "/cameras")
+    return "public, max-age=" + std::to_string(CAMERAS_MAX_AGE_SECONDS);
+  if(path == "/events" || path == "/events/" || path == "/events.geojson" || path == "/incidents")
+    return "public, max-age=" + std::to_string(EVENTS_MAX_AGE_SECONDS) + ", stale-while-revalidate=" + std::to_string(3 * EVENTS_MAX_AGE_SECONDS);
+  // Server counters are only meaningful at the moment they are read
+  if(path == "/status")
+    return "no-store";
+  // Changes and history depend on the caller's position, always revalidate
+  return "no-cache";
+}
+
+// Check an If-None-Match header (a list of tags, or "*") against a tag, ignoring weak prefixes
+bool matchesETag(const std::string& header, const std::string& etag) {
+  auto opaque = [](std::string_view tag){ return tag.starts_with("W/") ? tag.substr(2) : tag; };
+  std::stringstream ss(header);
+  std::string token;
+  // Elements delimited by ','
+  while(std::getline(ss, token, ',')) {
+    trim(token);
+    if(token == "*" || opaque(token) == opaque(etag))
+      return true;
+  }
+  return false;
+}
+
+// Pick the /events format from an Accept header, MessagePack only when it is weighted at least as high as JSON
+Traffic::EventFormat negotiateFormat(const std::string& accept) {
+  double msgpackWeight{ 0.0 }, jsonWeight{ -1.0 }, anyWeight{ 0.0 };
+  std::stringstream ss(accept);
+  std::string entry;
+  // Elements delimited by ','
+  while(std::getline(ss, entry, ',')) {
+    std::string type = entry.substr(0, entry.find(';'));
+    trim(type);
+    std::transform(type.begin(), type.end(), type.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    double weight{ 1.0 };
+    auto q = entry.find("q=");
+    if(q != std::string::npos)
+      weight = std::strtod(entry.c_str() + q + 2, nullptr);
+    if(type == "application/msgpack" || type == "application/x-msgpack" || type == "application/vnd.msgpack")
+      msgpackWeight = std::max(msgpackWeight, weight);
+    else if(type == "application/json")
+      jsonWeight = std::max(jsonWeight, weight);
+    else if(type == "*/*" || type == "application/*")
+      anyWeight = std::max(anyWeight, weight);
+  }
+  // JSON stays the default, an unnamed JSON takes the weight of the wildcards
+  if(msgpackWeight > 0.0 && msgpackWeight >= (jsonWeight < 0.0 ? anyWeight : jsonWeight))
+    return Traffic::EventFormat::MessagePack;
+  return Traffic::EventFormat::JSON;
+}
+
+// Check for a radius search wider than the event list allows
+bool radiusTooLarge(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  auto radiusParam = findQueryParam(queryParams, "radius");
+  if(!radiusParam)
+    return false;
+  auto radius = parseNumber(*radiusParam);
+  return radius && *radius > Traffic::EVENTS_RADIUS_LIMIT_KM;
+}
+
+// Check for a version 13 WebSocket handshake, header values are case-insensitive
+bool isWebSocketUpgrade(const Poco::Net::HTTPServerRequest& request) {
+  std::string upgrade = request.get("Upgrade", "");
+  std::transform(upgrade.begin(), upgrade.end(), upgrade.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+  return upgrade == "websocket" && request.get("Sec-WebSocket-Version", "") == "13" && request.has("Sec-WebSocket-Key");
+}
+
+// Sec-WebSocket-Accept value proving the handshake was understood (RFC 6455 section 4.2.2)
+std::string webSocketAccept(const std::string& key) {
+  Poco::SHA1Engine sha1;
+  sha1.update(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+  const Poco::DigestEngine::Digest& digest = sha1.digest();
+  std::ostringstream accept;
+  Poco::Base64Encoder encoder(accept);
+  encoder.write(reinterpret_cast<const char*>(digest.data()), static_cast<std::streamsize>(digest.size()));
+  encoder.close();
+  return accept.str();
+}
+
+// Records the time spent in a request handler once it returns, whichever path it returned from
+class HandlerTimer {
+private:
+  std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+  std::size_t series{ Metrics::requestSeries(Metrics::RequestPath::Other, Metrics::RequestFilter::None) };
+public:
+  HandlerTimer() = default;
+  ~HandlerTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    serverMetrics.recordRequest(elapsed);
+    Metrics::requestSeconds.observe(series, elapsed);
+  }
+  // Label the request's latency with its endpoint and the kind of filter it used
+  void label(const std::string& path, const std::vector<std::pair<std::string, std::string>>& queryParams) {
+    series = Metrics::requestSeries(Metrics::toRequestPath(path), Metrics::toRequestFilter(queryParams));
+  }
+
+  // Delete the copy constructor and assignment operator
+  HandlerTimer(const HandlerTimer&) = delete;
+  HandlerTimer& operator=(const HandlerTimer&) = delete;
+};
+
+// Server and store state read when /metrics is scraped
+const Metrics::Sampled apiThreads{ "traffic_api_threads", "Request handler threads in use.", "gauge",
+                                   []{ return static_cast<double>(serverMetrics.snapshot().currentThreads); } };
+const Metrics::Sampled apiQueueDepth{ "traffic_api_queue_depth", "Connections waiting for a request handler thread.", "gauge",
+                                      []{ return static_cast<double>(serverMetrics.queueDepth()); } };
+const Metrics::Sampled apiConnections{ "traffic_api_connections", "Open API connections.", "gauge",
+                                       []{ return static_cast<double>(serverMetrics.snapshot().currentConnections); } };
+const Metrics::Sampled apiRefused{ "traffic_api_refused_connections_total", "Connections refused with the queue full.", "counter",
+                                   []{ return static_cast<double>(serverMetrics.snapshot().refusedConnections); } };
+const Metrics::Sampled apiShed{ "traffic_api_shed_requests_total", "Requests answered with 503 while the queue was backed up.", "counter",
+                                []{ return static_cast<double>(serverMetrics.snapshot().shed); } };
+const Metrics::Sampled streamClients{ "traffic_stream_clients", "Open /events/stream and /events/socket connections.", "gauge",
+                                      []{ return static_cast<double>(eventStream.size()); } };
+const Metrics::Sampled storedEvents{ "traffic_events", "Events in the store.", "gauge", []{
+  std::lock_guard<Metrics::TimedMutex> lock(Traffic::eventsMutex);
+  return static_cast<double>(Traffic::mapEvents.size());
+} };
+
+// Server counters and live stream count for /status
+std::string serializeStatusToJSON() {
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.key("server");
+  serverMetrics.serializeToJSON(writer);
+  writer.key("streams").value(static_cast<std::uint64_t>(eventStream.size()));
+  writer.endObject();
+  return writer.release();
+}
+
+// Read a whole number setting from the environment, nullopt when unset or outside [minimum, maximum]
+std::optional<std::uint64_t> readSetting(const char* name, std::uint64_t minimum, std::uint64_t maximum) {
+  const char* text = std::getenv(name);
+  if(!text)
+    return std::nullopt;
+  std::optional<std::uint64_t> setting = parseUnsigned(text);
+  if(!setting || *setting < minimum || *setting > maximum) {
+    Output::logger.log(Output::LogLevel::WARN, "REST API", std::string("Ignoring invalid ") + name + " '" + text + "', expected "
+                       + std::to_string(minimum) + " to " + std::to_string(maximum));
+    return std::nullopt;
+  }
+  return setting;
+}
+
+} // namespace
+
 void RequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
+  HandlerTimer timer;
+  // Parse the URI
+  Poco::URI uri(request.getURI());
+  // Extract the request path and queries
+  std::string path = uri.getPath();
+  std::vector<std::pair<std::string, std::string>> queryParams = uri.getQueryParameters();
+  timer.label(path, queryParams);
+  // Turn requests away while connections are backing up in the queue, a quick 503 drains it far faster than
+  // serving them would. /status and /metrics are still answered so the overload can be observed
+  if(serverMetrics.overloaded() && path != "/status" && path != "/metrics") {
+    serverMetrics.recordShed();
+    const std::string message{ "Server busy, retry later." };
+    response.setStatus(Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+    response.set("Retry-After", std::to_string(SHED_RETRY_AFTER_SECONDS));
+    response.set("Cache-Control", "no-store");
+    response.setKeepAlive(false);   // Free the thread for the next queued connection
+    response.setContentType("text/plain");
+    response.setContentLength(static_cast<std::streamsize>(message.size()));
+    response.send() << message;
+    return;
+  }
   std::string contentType { "text/plain" }; // set default content-type
   std::string output { "" };  // set null output
+  ResponseCache::Body body;   // Serialized JSON, shared with the response cache
+  Compression::Encoding applied{ Compression::Encoding::Identity };   // Content-Encoding of the body
   // Check if the request method is GET
   if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET) {
     Poco::Net::HTTPResponse::HTTPStatus status = Poco::Net::HTTPResponse::HTTP_OK;
-    // Parse the URI
-    Poco::URI uri(request.getURI());
-    // Extract the request path
-    std::string path = uri.getPath();
 
-    if(path.find("/events") == 0) {
+    // Counters in the Prometheus text format, read fresh on every scrape
+    if(path == "/metrics") {
+      output = Metrics::serializeToPrometheus();
+      response.setStatus(status);
+      response.setContentType("text/plain; version=0.0.4");
+      response.set("Cache-Control", "no-store");
+      response.setContentLength(static_cast<std::streamsize>(output.size()));
+      response.send() << output;
+      return;
+    }
+
+    // Live changes are pushed over Server-Sent Events or a WebSocket, the connection is handed to the event stream
+    if(path == "/events/stream" || path == "/events/socket") {
+      std::optional<Subscription> subscription = parseSubscription(queryParams);
+      bool webSocket = path == "/events/socket";
+      // A reconnecting Server-Sent Events client sends the id of the last message it received
+      std::optional<std::uint64_t> lastSequence;
+      if(!webSocket && request.has("Last-Event-ID")) {
+        lastSequence = parseUnsigned(request.get("Last-Event-ID"));
+        if(!lastSequence)
+          subscription.reset();
+      }
+      bool upgrade = !webSocket || isWebSocketUpgrade(request);
+      if(subscription && upgrade) {
+        Output::logger.log(Output::LogLevel::INFO, "REST API", "Stream opened at: '" + uri.toString() + '\'');
+        if(webSocket) {
+          response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS);
+          response.set("Upgrade", "websocket");
+          response.set("Connection", "Upgrade");
+          response.set("Sec-WebSocket-Accept", webSocketAccept(request.get("Sec-WebSocket-Key")));
+          response.setContentLength(0);
+        } else {
+          response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+          response.setContentType("text/event-stream");
+          response.set("Cache-Control", "no-cache");
+          response.set("X-Accel-Buffering", "no");   // Stop reverse proxies from buffering the stream
+          response.setKeepAlive(false);
+        }
+        response.send().flush();
+        eventStream.subscribe(static_cast<Poco::Net::HTTPServerRequestImpl&>(request).detachSocket(),
+                              webSocket ? StreamProtocol::WebSocket : StreamProtocol::ServerSentEvents, *subscription, lastSequence);
+        return;
+      }
+      response.set("Cache-Control", "no-store");
+      response.setStatus(upgrade ? Poco::Net::HTTPResponse::HTTP_NOT_FOUND : Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+      response.setContentType(contentType);
+      output = upgrade ? "Invalid query parameters." : "WebSocket upgrade required.";
+      response.setContentLength(static_cast<std::streamsize>(output.size()));
+      response.send() << output;
+      return;
+    }
+
+    // Match the endpoint exactly so sub-paths can't fall through to /events
+    if(path == "/events" || path == "/events/" || path == "/events.geojson" || path == "/events/changes" || path == "/events/history" || path == "/cameras" || path == "/incidents" || path == "/status") {
       std::string msg = "Request received at: '" + uri.toString() + '\'';
       Output::logger.log(Output::LogLevel::INFO, "REST API", msg);
 
-      // Parse the queries
-      std::vector<std::pair<std::string, std::string>> queryParams = uri.getQueryParameters();
-      
-      // Serialize the data based on the params
-      auto jsonData = Traffic::serializeEventsToJSON(queryParams);
-      if(jsonData) {
-        // Create the writer
-        Json::StreamWriterBuilder writer;
-        
-        // Set up minification opts
-        writer["indentation"] = "";
-        writer["commentStyle"] = "None";
-        writer["precision"] = 6;
-        writer["emitUTF8"] = true;
-
-        // Write the data string
-        output = Json::writeString(writer, *jsonData);
-        // Set the content type
-        contentType = "application/json";
+      // Pick the response encoding
+      Compression::Encoding negotiated = Compression::negotiate(request.get("Accept-Encoding", ""));
+
+      // The event list only changes with the store, serve repeated queries from the cache
+      bool geoJSON = path == "/events.geojson";
+      bool cacheable = path == "/events" || path == "/events/" || geoJSON;
+      // Only the event list is offered in binary, every other endpoint answers in JSON
+      Traffic::EventFormat format = Traffic::EventFormat::JSON;
+      if(geoJSON)
+        format = Traffic::EventFormat::GeoJSON;
+      else if(cacheable)
+        format = negotiateFormat(request.get("Accept", ""));
+      // An oversized radius is a valid query the server refuses to run, not an unknown one
+      if(cacheable && radiusTooLarge(queryParams)) {
+        response.set("Cache-Control", "no-store");
+        response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+        response.setContentType(contentType);
+        output = "Radius is larger than " + std::to_string(static_cast<int>(Traffic::EVENTS_RADIUS_LIMIT_KM)) + " km.";
+        response.setContentLength(static_cast<std::streamsize>(output.size()));
+        response.send() << output;
+        return;
+      }
+      std::string cacheKey;
+      std::uint64_t version{ 0 };
+      if(cacheable) {
+        // Each format is a separate entry, which also gives it its own entity tag
+        const char* keyPath = format == Traffic::EventFormat::MessagePack ? "/events.msgpack" : geoJSON ? "/events.geojson" : "/events";
+        cacheKey = ResponseCache::makeKey(keyPath, queryParams);
+        version = storeVersion();
+        // The client already holds this version in some encoding, answer without serializing anything
+        if(request.has("If-None-Match")) {
+          for(std::size_t i = 0; i < Compression::ENCODING_COUNT; i++) {
+            std::string held = ResponseCache::makeETag(cacheKey, version, static_cast<Compression::Encoding>(i));
+            if(!matchesETag(request.get("If-None-Match"), held))
+              continue;
+            response.set("ETag", held);
+            response.set("Cache-Control", cacheControl(path));
+            response.set("Vary", geoJSON ? "Accept-Encoding" : "Accept, Accept-Encoding");
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+            response.setContentLength(0);
+            response.send();
+            return;
+          }
+        }
+        auto cached = responseCache.find(cacheKey, version, negotiated);
+        body = cached.body;
+        applied = cached.encoding;
+      }
+
+      // History is read out of the log file without holding any lock, stream it straight to the socket
+      if(path == "/events/history") {
+        if(auto filters = Traffic::parseHistoryQuery(queryParams)) {
+          response.setStatus(status);
+          response.setContentType("application/json");
+          response.setChunkedTransferEncoding(true);
+          response.set("Cache-Control", cacheControl(path));
+          JSON::Writer writer(response.send());
+          Traffic::writeHistoryJSON(*filters, writer);
+          writer.flush();
+          return;
+        }
+      } else if(!body) {
+        // A compressed variant can start from the cached plain body
+        if(cacheable && negotiated != Compression::Encoding::Identity)
+          body = responseCache.find(cacheKey, version, Compression::Encoding::Identity).body;
+        if(!body) {
+          // Serialize the data based on the params
+          std::optional<std::string> data;
+          if(path == "/status")
+            data = serializeStatusToJSON();
+          else if(path == "/events/changes")
+            data = Traffic::serializeChangesToJSON(queryParams);
+          else if(path == "/cameras")
+            data = Traffic::serializeCamerasToJSON(queryParams);
+          else if(path == "/incidents")
+            data = Traffic::serializeIncidentsToJSON(queryParams);
+          else
+            data = Traffic::serializeEvents(queryParams, format);
+          if(data) {
+            body = std::make_shared<const std::string>(std::move(*data));
+            if(cacheable)
+              responseCache.insert(cacheKey, version, Compression::Encoding::Identity, { body, Compression::Encoding::Identity });
+          }
+        }
+        // Compress once and keep the variant, small bodies stay plain
+        if(body && negotiated != Compression::Encoding::Identity) {
+          if(auto compressed = Compression::compress(*body, negotiated)) {
+            body = std::make_shared<const std::string>(std::move(*compressed));
+            applied = negotiated;
+          }
+          if(cacheable)
+            responseCache.insert(cacheKey, version, negotiated, { body, applied });
+        }
+      }
+      if(body) {
+        // Set the content type and caching headers
+        contentType = format == Traffic::EventFormat::MessagePack ? "application/msgpack"
+                      : format == Traffic::EventFormat::GeoJSON ? "application/geo+json" : "application/json";
+        response.set("Cache-Control", cacheControl(path));
+        response.set("Vary", cacheable && !geoJSON ? "Accept, Accept-Encoding" : "Accept-Encoding");
+        if(applied != Compression::Encoding::Identity)
+          response.set("Content-Encoding", std::string(Compression::toString(applied)));
+        if(cacheable)
+          response.set("ETag", ResponseCache::makeETag(cacheKey, version, applied));
       } else {
         status = Poco::Net::HTTPResponse::HTTP_NOT_FOUND;
         output = "Invalid query parameters.";
@@ -70,10 +409,15 @@ void RequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::
       std::string errMsg = "Request received at: '" + uri.toString() + "' (\"" + output + "\")";
       Output::logger.log(Output::LogLevel::WARN, "REST API", errMsg);
     }
+    const std::string& content = body ? *body : output;
+    // Errors must never be served from a proxy's cache
+    if(!body)
+      response.set("Cache-Control", "no-store");
     response.setStatus(status);
     response.setContentType(contentType);
+    response.setContentLength(static_cast<std::streamsize>(content.size()));
     std::ostream& ostr = response.send();
-    ostr << output;
+    ostr << content;
   } else {
     response.setStatus(Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
     output = "Method not allowed!";
@@ -90,17 +434,56 @@ Poco::Net::HTTPRequestHandler* RequestHandlerFactory::createRequestHandler(const
   return new RequestHandler;
 }
 
+ServerConfig loadServerConfig() {
+  ServerConfig config;
+  if(auto port = readSetting("TRAFFIC_API_PORT", 1, 65535))
+    config.port = static_cast<std::uint16_t>(*port);
+  if(auto threads = readSetting("TRAFFIC_API_THREADS", 1, 1024))
+    config.maxThreads = static_cast<int>(*threads);
+  if(auto queued = readSetting("TRAFFIC_API_MAX_QUEUED", 1, 65536))
+    config.maxQueued = static_cast<int>(*queued);
+  config.shedQueueDepth = config.maxQueued * 3 / 4;
+  if(auto shed = readSetting("TRAFFIC_API_SHED_QUEUED", 0, static_cast<std::uint64_t>(config.maxQueued)))
+    config.shedQueueDepth = static_cast<int>(*shed);
+  if(auto keepAlive = readSetting("TRAFFIC_API_KEEP_ALIVE", 0, 1))
+    config.keepAlive = *keepAlive == 1;
+  if(auto requests = readSetting("TRAFFIC_API_KEEP_ALIVE_REQUESTS", 0, 1000000))
+    config.maxKeepAliveRequests = static_cast<int>(*requests);
+  if(auto keepAliveTimeout = readSetting("TRAFFIC_API_KEEP_ALIVE_TIMEOUT", 1, 3600))
+    config.keepAliveTimeout = std::chrono::seconds(*keepAliveTimeout);
+  if(auto timeout = readSetting("TRAFFIC_API_TIMEOUT", 1, 3600))
+    config.timeout = std::chrono::seconds(*timeout);
+  return config;
+}
+
 void startApiServer() {
-  int serverPort{6969};
-  Poco::Net::ServerSocket socket(serverPort);
-  Poco::Net::HTTPServer server(new RequestHandlerFactory, socket, new Poco::Net::HTTPServerParams);
+  ServerConfig config = loadServerConfig();
+  Poco::Net::HTTPServerParams* params = new Poco::Net::HTTPServerParams;
+  params->setMaxThreads(config.maxThreads);
+  params->setMaxQueued(config.maxQueued);
+  params->setKeepAlive(config.keepAlive);
+  params->setMaxKeepAliveRequests(config.maxKeepAliveRequests);
+  params->setKeepAliveTimeout(Poco::Timespan(static_cast<long>(config.keepAliveTimeout.count()), 0));
+  params->setTimeout(Poco::Timespan(static_cast<long>(config.timeout.count()), 0));
+  // The default pool is capped at 16 threads, a dedicated one lets the thread setting go higher
+  // Declared before the server so it outlives every connection the server hands it
+  Poco::ThreadPool pool(std::min(2, config.maxThreads), config.maxThreads);
+  Poco::Net::ServerSocket socket(config.port);
+  Poco::Net::HTTPServer server(new RequestHandlerFactory, pool, socket, params);
   server.start();
-  std::string msg = "Starting REST API server on port " + std::to_string(serverPort);
+  serverMetrics.attach(server, config.maxQueued, config.shedQueueDepth);
+  std::string msg = "Starting REST API server on port " + std::to_string(config.port) + " with " + std::to_string(config.maxThreads)
+                    + " threads, " + std::to_string(config.maxQueued) + " queued connections (shedding at "
+                    + std::to_string(config.shedQueueDepth) + ')';
   Output::logger.log(Output::LogLevel::INFO, "REST API", msg);
-  std::cout << "API server running on port " << serverPort << "...\n";
+  std::cout << "API server running on port " << config.port << "...\n";
   while (!programEnd) {
       std::this_thread::sleep_for(std::chrono::seconds(5));
   }
+  // Let running handlers finish before they lose the server they read counters from
+  server.stopAll();
+  pool.joinAll();
+  serverMetrics.detach();
 }
 
 //int ServerApp::main(const std::vector<std::string>& args) {
@@ -129,4 +512,48 @@ std::optional<std::string> findQueryParam(const std::vector<std::pair<std::strin
   return std::nullopt;
 }
 
+// Convert a query value to a number, rejecting trailing characters and non-finite values
+std::optional<double> parseNumber(const std::string& value) {
+  double number{ 0.0 };
+  const char* end = value.data() + value.size();
+  auto [ptr, ec] = std::from_chars(value.data(), end, number);
+  if(ec != std::errc() || ptr != end || !std::isfinite(number))
+    return std::nullopt;
+  return number;
+}
+
+// Convert a query value to an unsigned integer, rejecting signs and trailing characters
+std::optional<std::uint64_t> parseUnsigned(const std::string& value) {
+  std::uint64_t number{ 0 };
+  const char* end = value.data() + value.size();
+  auto [ptr, ec] = std::from_chars(value.data(), end, number);
+  if(ec != std::errc() || ptr != end || value.empty())
+    return std::nullopt;
+  return number;
+}
+
+// Parse a bounding box in GeoJSON order (west,south,east,north)
+std::optional<Traffic::BoundingBox> parseBoundingBox(const std::string& value) {
+  std::vector<double> edges;
+  std::stringstream ss(value);
+  std::string token;
+  // Elements delimited by ','
+  while(std::getline(ss, token, ',')) {
+    auto edge = parseNumber(token);
+    if(!edge)
+      return std::nullopt;
+    edges.push_back(*edge);
+  }
+  if(edges.size() != 4)
+    return std::nullopt;
+  auto& west = edges[0];
+  auto& south = edges[1];
+  auto& east = edges[2];
+  auto& north = edges[3];
+  // Reject inverted or out of range boxes
+  if(west > east || south > north || south < -90.0 || north > 90.0 || west < -180.0 || east > 180.0)
+    return std::nullopt;
+  return Traffic::BoundingBox{ west, east, north, south };
+}
+
 }// namespace RestAPI
@@ -0,0 +1,123 @@
+#include "ServerMetrics.h"
+#include <Poco/Net/HTTPServer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace RestAPI {
+
+ServerMetrics serverMetrics;
+
+void ServerMetrics::attach(const Poco::Net::HTTPServer& running, int queueLimit, int shedDepth) {
+  maxQueued.store(queueLimit, std::memory_order_relaxed);
+  shedQueueDepth.store(shedDepth, std::memory_order_relaxed);
+  server.store(&running, std::memory_order_release);
+}
+
+void ServerMetrics::detach() {
+  server.store(nullptr, std::memory_order_release);
+}
+
+int ServerMetrics::queueDepth() const {
+  const Poco::Net::HTTPServer* running = server.load(std::memory_order_acquire);
+  return running ? running->queuedConnections() : 0;
+}
+
+// Poco refuses connections outright once its queue is full, shedding below that limit answers them with a 503 instead
+bool ServerMetrics::overloaded() const {
+  int depth = shedQueueDepth.load(std::memory_order_relaxed);
+  return depth > 0 && queueDepth() >= depth;
+}
+
+void ServerMetrics::recordRequest(std::chrono::steady_clock::duration elapsed) {
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  double millis = static_cast<double>(micros) / 1000.0;
+  // First bucket whose bound holds the latency, the overflow bucket otherwise
+  std::size_t bucket = static_cast<std::size_t>(std::lower_bound(LATENCY_BUCKETS_MS.begin(), LATENCY_BUCKETS_MS.end(), millis) - LATENCY_BUCKETS_MS.begin());
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  latencyMicros.fetch_add(static_cast<std::uint64_t>(std::max<decltype(micros)>(micros, 0)), std::memory_order_relaxed);
+  requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+ServerMetrics::Snapshot ServerMetrics::snapshot() const {
+  Snapshot result;
+  if(const Poco::Net::HTTPServer* running = server.load(std::memory_order_acquire)) {
+    result.currentThreads = running->currentThreads();
+    result.maxThreads = running->maxThreads();
+    result.queuedConnections = running->queuedConnections();
+    result.currentConnections = running->currentConnections();
+    result.totalConnections = running->totalConnections();
+    result.refusedConnections = running->refusedConnections();
+  }
+  result.maxQueued = maxQueued.load(std::memory_order_relaxed);
+  result.requests = requests.load(std::memory_order_relaxed);
+  result.shed = shed.load(std::memory_order_relaxed);
+  result.latencyMicros = latencyMicros.load(std::memory_order_relaxed);
+  for(std::size_t i = 0; i < buckets.size(); i++)
+    result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+  return result;
+}
+
+void ServerMetrics::serializeToJSON(JSON::Writer& writer) const {
+  Snapshot current = snapshot();
+  std::uint64_t observed{ 0 };
+  for(std::uint64_t count : current.buckets)
+    observed += count;
+  writer.beginObject();
+  writer.key("threads").beginObject();
+  writer.key("current").value(static_cast<std::int64_t>(current.currentThreads));
+  writer.key("max").value(static_cast<std::int64_t>(current.maxThreads));
+  writer.endObject();
+  writer.key("queue").beginObject();
+  writer.key("depth").value(static_cast<std::int64_t>(current.queuedConnections));
+  writer.key("max").value(static_cast<std::int64_t>(current.maxQueued));
+  writer.endObject();
+  writer.key("connections").beginObject();
+  writer.key("current").value(static_cast<std::int64_t>(current.currentConnections));
+  writer.key("total").value(static_cast<std::int64_t>(current.totalConnections));
+  writer.key("refused").value(static_cast<std::int64_t>(current.refusedConnections));
+  writer.endObject();
+  writer.key("requests").value(current.requests);
+  writer.key("shed").value(current.shed);
+  writer.key("latency").beginObject();
+  writer.key("count").value(observed);
+  writer.key("sum_ms").value(static_cast<double>(current.latencyMicros) / 1000.0);
+  writer.key("p50_ms").value(latencyQuantile(current, 0.5));
+  writer.key("p95_ms").value(latencyQuantile(current, 0.95));
+  writer.key("p99_ms").value(latencyQuantile(current, 0.99));
+  // Cumulative like a Prometheus histogram, the last bucket counts every request
+  writer.key("buckets").beginArray();
+  std::uint64_t cumulative{ 0 };
+  for(std::size_t i = 0; i < current.buckets.size(); i++) {
+    cumulative += current.buckets[i];
+    writer.beginObject();
+    if(i < LATENCY_BUCKETS_MS.size())
+      writer.key("le_ms").value(LATENCY_BUCKETS_MS[i]);
+    else
+      writer.key("le_ms").null();
+    writer.key("count").value(cumulative);
+    writer.endObject();
+  }
+  writer.endArray();
+  writer.endObject();
+  writer.endObject();
+}
+
+double latencyQuantile(const ServerMetrics::Snapshot& snapshot, double quantile) {
+  std::uint64_t total{ 0 };
+  for(std::uint64_t count : snapshot.buckets)
+    total += count;
+  if(total == 0)
+    return 0.0;
+  double rank = quantile * static_cast<double>(total);
+  std::uint64_t cumulative{ 0 };
+  for(std::size_t i = 0; i < LATENCY_BUCKETS_MS.size(); i++) {
+    cumulative += snapshot.buckets[i];
+    if(static_cast<double>(cumulative) >= rank)
+      return LATENCY_BUCKETS_MS[i];
+  }
+  return LATENCY_BUCKETS_MS.back();
+}
+
+} // namespace RestAPI
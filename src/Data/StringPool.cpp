@@ -0,0 +1,123 @@
+#include "StringPool.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Intern {
+
+namespace {
+
+// The shared string table
+struct Pool {
+  std::mutex mutex;
+  std::unordered_map<std::string_view, std::unique_ptr<Entry>> entries;  // Keys view into their own entry
+  std::size_t bytes{ 0 };
+};
+
+// Construct on first use so global handles can be created safely during static initialization
+// Never destroyed, global stores may still release their handles after it would have been torn down at exit
+Pool& pool() {
+  static Pool* instance = new Pool;
+  return *instance;
+}
+
+const std::string emptyString{};
+
+} // namespace
+
+// Intern a value, reusing the existing entry if it is already in the table
+String::String(std::string_view value) {
+  if(value.empty())
+    return;
+  Pool& table = pool();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto found = table.entries.find(value);
+  if(found == table.entries.end()) {
+    auto created = std::make_unique<Entry>(value);
+    std::string_view key{ created->value };
+    table.bytes += key.size();
+    found = table.entries.emplace(key, std::move(created)).first;
+  }
+  entry = found->second.get();
+  // Increment under the lock so a concurrent purge can't remove the entry first
+  entry->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+String::String(const String& other)
+: entry{ other.entry }
+{
+  if(entry)
+    entry->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+String::String(String&& other) noexcept
+: entry{ other.entry }
+{
+  other.entry = nullptr;
+}
+
+String& String::operator=(const String& other) {
+  if(entry != other.entry) {
+    if(other.entry)
+      other.entry->refs.fetch_add(1, std::memory_order_relaxed);
+    release();
+    entry = other.entry;
+  }
+  return *this;
+}
+
+String& String::operator=(String&& other) noexcept {
+  if(this != &other) {
+    release();
+    entry = other.entry;
+    other.entry = nullptr;
+  }
+  return *this;
+}
+
+// Drop this handle's reference, the entry itself is only freed by purge()
+void String::release() {
+  if(entry) {
+    entry->refs.fetch_sub(1, std::memory_order_release);
+    entry = nullptr;
+  }
+}
+
+const std::string& String::str() const {
+  return entry ? entry->value : emptyString;
+}
+
+std::size_t size() {
+  Pool& table = pool();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.entries.size();
+}
+
+std::size_t bytes() {
+  Pool& table = pool();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.bytes;
+}
+
+// Remove all unreferenced entries
+// Handles can only be created from the table under the lock, or copied from a live handle,
+// so an entry with no references can't be revived while we hold the lock
+std::size_t purge() {
+  Pool& table = pool();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  std::size_t removed{ 0 };
+  for(auto it = table.entries.begin(); it != table.entries.end();) {
+    if(it->second->refs.load(std::memory_order_acquire) == 0) {
+      table.bytes -= it->first.size();
+      it = table.entries.erase(it);
+      removed++;
+    } else {
+      ++it;
+    }
+  }
+  return removed;
+}
+
+} // namespace Intern
@@ -0,0 +1,95 @@
+#include "CameraStore.h"
+#include "RestAPI.h"
+#include "Traffic.h"
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+CameraStore cameraStore;
+
+void CameraStore::reindex() {
+  for(auto& bucket : regionIndex)
+    bucket.clear();
+  spatialIndex.clear();
+  onlineIndex.clear();
+  for(Handle handle = 0; handle < cameras.size(); handle++) {
+    const Camera& camera = cameras[handle];
+    regionIndex[static_cast<std::size_t>(camera.getRegion())].push_back(handle);
+    spatialIndex.insert(handle, camera.getLocation());
+    if(camera.isOnline())
+      onlineIndex.insert(handle, camera.getLocation());
+  }
+}
+
+// Swap in a source's new cameras, the list was built before taking the lock
+void CameraStore::replace(DataSource source, std::vector<Camera>&& updated) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  std::erase_if(cameras, [source](const Camera& camera){ return camera.getSource() == source; });
+  cameras.reserve(cameras.size() + updated.size());
+  for(Camera& camera : updated)
+    cameras.push_back(std::move(camera));
+  reindex();
+}
+
+// Search only the grid cells within the radius
+std::vector<NearbyCamera> CameraStore::nearest(const Location& location, std::size_t count, double radiusKm) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  std::vector<NearbyCamera> matches;
+  auto found = onlineIndex.queryNearest(location, count, radiusKm);
+  matches.reserve(found.size());
+  for(const auto& [handle, distance] : found)
+    matches.push_back({ Intern::String(cameras[handle].getID()), static_cast<float>(distance) });
+  return matches;
+}
+
+std::size_t CameraStore::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return cameras.size();
+}
+
+void linkCameras(Event& event) {
+  if(!event.hasLocation()) {
+    event.setNearbyCameras({});
+    return;
+  }
+  event.setNearbyCameras(cameraStore.nearest(event.getLocation(), NEAREST_CAMERA_COUNT, NEAREST_CAMERA_RADIUS_KM));
+}
+
+void linkCameras(EventStore& store) {
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+  for(Event* event : store.select(std::nullopt, std::nullopt))
+    linkCameras(*event);
+  store.touch();
+}
+
+// Serialize the cameras matching a query
+std::optional<std::string> serializeCamerasToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : queryParams) {
+    if(key != "region" && key != "bbox")
+      return std::nullopt;
+  }
+  std::optional<Region> filterRegion{ std::nullopt };
+  if(auto regionParam = RestAPI::findQueryParam(queryParams, "region"))
+    filterRegion = toRegion(*regionParam);
+  // Set the bounding box "west,south,east,north"
+  auto boxParam = RestAPI::findQueryParam(queryParams, "bbox");
+  const std::optional<BoundingBox> filterBox = boxParam ? RestAPI::parseBoundingBox(*boxParam) : std::nullopt;
+  if(boxParam && !filterBox)
+    return std::nullopt;
+
+  JSON::Writer writer;
+  writer.beginArray();
+  cameraStore.visit(filterRegion, filterBox, [&writer](const Camera& camera){
+    camera.serializeToJSON(writer);
+  });
+  writer.endArray();
+  return writer.release();
+}
+
+} // namespace Traffic
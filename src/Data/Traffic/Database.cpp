@@ -0,0 +1,429 @@
+#include "Database.h"
+#include "EventStore.h"
+#include "Output.h"
+#include "Traffic.h"
+#include <sqlite3.h>
+#include <array>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+extern const std::string DATABASE_PATH{ "logs/traffic.db" };
+EventDatabase eventDatabase;
+
+namespace {
+
+// SQLite translation of database/scripts/create_tables.sql
+// Roadways are unique per region so they can be resolved by name, and the fixed region rows
+// from insert_data.sql are seeded so each Region maps to a known market_regions row
+constexpr const char* SCHEMA = R"sql(
+PRAGMA journal_mode = WAL;
+PRAGMA synchronous = NORMAL;
+PRAGMA foreign_keys = ON;
+
+CREATE TABLE IF NOT EXISTS countries (
+  country_id INTEGER PRIMARY KEY,
+  name TEXT NOT NULL,
+  iso_code TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS states_provinces (
+  state_id INTEGER PRIMARY KEY,
+  country_id INTEGER NOT NULL REFERENCES countries (country_id),
+  name TEXT NOT NULL,
+  abbreviation TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS market_regions (
+  region_id INTEGER PRIMARY KEY,
+  state_id INTEGER NOT NULL REFERENCES states_provinces (state_id),
+  name TEXT NOT NULL,
+  abbreviation TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS roadway_suffix (
+  suffix_id INTEGER PRIMARY KEY,
+  text TEXT NOT NULL,
+  abbreviation TEXT NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS main_roadways (
+  roadway_id INTEGER PRIMARY KEY,
+  region_id INTEGER NOT NULL REFERENCES market_regions (region_id),
+  name TEXT NOT NULL,
+  suffix_id INTEGER REFERENCES roadway_suffix (suffix_id),
+  UNIQUE (region_id, name)
+);
+
+CREATE TABLE IF NOT EXISTS event_categories (
+  category_id INTEGER PRIMARY KEY,
+  name TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS event_status (
+  status_id INTEGER PRIMARY KEY,
+  name TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS traffic_events (
+  event_id TEXT PRIMARY KEY,
+  roadway_id INTEGER NOT NULL REFERENCES main_roadways (roadway_id),
+  travel_direction TEXT CHECK (travel_direction IN (
+    'NB', 'SB', 'EB', 'WB', 'Both', 'Outbound',
+    'Inbound', 'Outer Loop', 'Inner Loop')),
+  category_id INTEGER NOT NULL REFERENCES event_categories (category_id),
+  status_id INTEGER NOT NULL REFERENCES event_status (status_id),
+  details TEXT NOT NULL,
+  date_reported TEXT NOT NULL,
+  date_updated TEXT NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS geo_coordinates (
+  event_id TEXT PRIMARY KEY REFERENCES traffic_events (event_id),
+  latitude REAL NOT NULL,
+  longitude REAL NOT NULL
+);
+
+INSERT OR IGNORE INTO countries VALUES
+  (1, 'United States of America', 'US'),
+  (2, 'Canada', 'CA');
+
+INSERT OR IGNORE INTO states_provinces VALUES
+  (1, 2, 'Ontario', 'ON'),
+  (2, 2, 'Quebec', 'QC'),
+  (3, 1, 'New York', 'NY'),
+  (4, 1, 'New Jersey', 'NJ');
+
+INSERT OR IGNORE INTO market_regions VALUES
+  (1, 3, 'Syracuse', 'SYR'),
+  (2, 3, 'Rochester', 'ROC'),
+  (3, 3, 'Buffalo', 'BUF'),
+  (4, 3, 'Albany', 'ALB'),
+  (5, 3, 'Binghamton', 'BNG'),
+  (6, 4, 'Sussex', 'SUS'),
+  (7, 1, 'Toronto', 'TO'),
+  (8, 2, 'Montreal', 'MTL'),
+  (9, 1, 'Ottawa', 'OTT');
+)sql";
+
+// Seeded market_regions row for each Region
+std::optional<std::int64_t> regionID(Region region) {
+  switch(region) {
+    case Region::Syracuse:
+      return 1;
+    case Region::Rochester:
+      return 2;
+    case Region::Buffalo:
+      return 3;
+    case Region::Albany:
+      return 4;
+    case Region::Binghamton:
+      return 5;
+    case Region::Toronto:
+      return 7;
+    case Region::Montreal:
+      return 8;
+    case Region::Ottawa:
+      return 9;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Row key of an event, IDs are only unique within a source so the source is part of it ("NYSDOT:123")
+std::string rowKey(DataSource source, std::string_view id) {
+  std::string key{ sourceName(source) };
+  key += ':';
+  key += id;
+  return key;
+}
+
+// Copy an event into a row, events outside a known market have no region to reference
+std::optional<EventRow> toRow(const Event& event) {
+  EventFields fields = event.getFields();
+  if(!regionID(fields.summary.region))
+    return std::nullopt;
+  EventRow row;
+  row.id = rowKey(fields.summary.dataSource, fields.id);
+  row.region = fields.summary.region;
+  row.roadway = fields.mainStreet;
+  row.category = fields.title;
+  row.status = event.getStatusText();
+  // Only the values allowed by the travel_direction enum are stored
+  if(fields.summary.direction != Direction::UNKNOWN && fields.summary.direction != Direction::OTHER)
+    row.direction = std::string(toString(fields.summary.direction));
+  row.details = fields.description;
+  row.updated = fields.summary.timeUpdated;
+  row.reported = fields.summary.timeReported ? fields.summary.timeReported : fields.summary.timeUpdated;
+  if(event.hasLocation())
+    row.location = fields.location;
+  return row;
+}
+
+} // namespace
+
+EventDatabase::~EventDatabase() {
+  stop();
+  if(db) {
+    while(sqlite3_stmt* statement = sqlite3_next_stmt(db, nullptr))
+      sqlite3_finalize(statement);
+    sqlite3_close(db);
+  }
+}
+
+// Open the database, create the schema and compile the statements
+bool EventDatabase::open(const std::string& path) {
+  if(!Output::createDirIfMissing(path))
+    return false;
+  if(sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+    Output::logger.log(Output::LogLevel::ERROR, "DATABASE", "Failed to open database: " + path);
+    return false;
+  }
+  char* error{ nullptr };
+  if(sqlite3_exec(db, SCHEMA, nullptr, nullptr, &error) != SQLITE_OK) {
+    Output::logger.log(Output::LogLevel::ERROR, "DATABASE", "Failed to create schema: " + std::string(error ? error : ""));
+    sqlite3_free(error);
+    return false;
+  }
+  if(!prepare())
+    return false;
+  Output::logger.log(Output::LogLevel::INFO, "DATABASE", "Opened database: " + path);
+  return true;
+}
+
+// Compile every statement used by the writer
+bool EventDatabase::prepare() {
+  const std::array<std::pair<sqlite3_stmt**, const char*>, 15> sources{{
+    { &statements.begin, "BEGIN" },
+    { &statements.commit, "COMMIT" },
+    { &statements.rollback, "ROLLBACK" },
+    { &statements.clearCoordinates, "DELETE FROM geo_coordinates" },
+    { &statements.clearEvents, "DELETE FROM traffic_events" },
+    { &statements.insertRoadway, "INSERT OR IGNORE INTO main_roadways (region_id, name) VALUES (?1, ?2)" },
+    { &statements.selectRoadway, "SELECT roadway_id FROM main_roadways WHERE region_id = ?1 AND name = ?2" },
+    { &statements.insertCategory, "INSERT OR IGNORE INTO event_categories (name) VALUES (?1)" },
+    { &statements.selectCategory, "SELECT category_id FROM event_categories WHERE name = ?1" },
+    { &statements.insertStatus, "INSERT OR IGNORE INTO event_status (name) VALUES (?1)" },
+    { &statements.selectStatus, "SELECT status_id FROM event_status WHERE name = ?1" },
+    { &statements.upsertEvent,
+      // Times are stored in the schema's DATETIME(3) text format
+      "INSERT INTO traffic_events VALUES (?1, ?2, ?3, ?4, ?5, ?6, "
+      "strftime('%Y-%m-%d %H:%M:%f', ?7, 'unixepoch'), strftime('%Y-%m-%d %H:%M:%f', ?8, 'unixepoch')) "
+      "ON CONFLICT (event_id) DO UPDATE SET roadway_id = excluded.roadway_id, travel_direction = excluded.travel_direction, "
+      "category_id = excluded.category_id, status_id = excluded.status_id, details = excluded.details, "
+      "date_reported = excluded.date_reported, date_updated = excluded.date_updated" },
+    { &statements.upsertCoordinates,
+      "INSERT INTO geo_coordinates VALUES (?1, ?2, ?3) "
+      "ON CONFLICT (event_id) DO UPDATE SET latitude = excluded.latitude, longitude = excluded.longitude" },
+    { &statements.deleteCoordinates, "DELETE FROM geo_coordinates WHERE event_id = ?1" },
+    { &statements.deleteEvent, "DELETE FROM traffic_events WHERE event_id = ?1" }
+  }};
+  for(const auto& [statement, sql] : sources) {
+    if(sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, statement, nullptr) != SQLITE_OK) {
+      Output::logger.log(Output::LogLevel::ERROR, "DATABASE", "Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+      return false;
+    }
+  }
+  return true;
+}
+
+// Run a bound statement to completion and reset it for reuse
+bool EventDatabase::execute(sqlite3_stmt* statement) {
+  int result = sqlite3_step(statement);
+  while(result == SQLITE_ROW)
+    result = sqlite3_step(statement);
+  sqlite3_reset(statement);
+  sqlite3_clear_bindings(statement);
+  return result == SQLITE_DONE;
+}
+
+// Get the ID for a lookup table value, inserting it the first time it is seen
+// Roadways are scoped to a region, the region is bound ahead of the name when given
+std::optional<std::int64_t> EventDatabase::lookup(std::unordered_map<std::string, std::int64_t>& cache, const std::string& key,
+                                                  sqlite3_stmt* insert, sqlite3_stmt* select, std::optional<std::int64_t> regionID) {
+  std::string cacheKey = regionID ? std::to_string(*regionID) + ':' + key : key;
+  if(auto found = cache.find(cacheKey); found != cache.end())
+    return found->second;
+  int nameIndex = regionID ? 2 : 1;
+  if(regionID)
+    sqlite3_bind_int64(insert, 1, *regionID);
+  sqlite3_bind_text(insert, nameIndex, key.data(), static_cast<int>(key.size()), SQLITE_STATIC);
+  if(!execute(insert))
+    return std::nullopt;
+  if(regionID)
+    sqlite3_bind_int64(select, 1, *regionID);
+  sqlite3_bind_text(select, nameIndex, key.data(), static_cast<int>(key.size()), SQLITE_STATIC);
+  std::optional<std::int64_t> id;
+  if(sqlite3_step(select) == SQLITE_ROW)
+    id = sqlite3_column_int64(select, 0);
+  sqlite3_reset(select);
+  sqlite3_clear_bindings(select);
+  if(id)
+    cache.emplace(std::move(cacheKey), *id);
+  return id;
+}
+
+// Insert or update an event and its coordinates
+bool EventDatabase::writeRow(const EventRow& row) {
+  auto region = regionID(row.region);
+  auto roadway = lookup(roadwayIDs, row.roadway, statements.insertRoadway, statements.selectRoadway, region);
+  auto category = lookup(categoryIDs, row.category, statements.insertCategory, statements.selectCategory, std::nullopt);
+  auto status = lookup(statusIDs, row.status, statements.insertStatus, statements.selectStatus, std::nullopt);
+  if(!roadway || !category || !status)
+    return false;
+
+  sqlite3_stmt* event = statements.upsertEvent;
+  sqlite3_bind_text(event, 1, row.id.data(), static_cast<int>(row.id.size()), SQLITE_STATIC);
+  sqlite3_bind_int64(event, 2, *roadway);
+  if(row.direction)
+    sqlite3_bind_text(event, 3, row.direction->data(), static_cast<int>(row.direction->size()), SQLITE_STATIC);
+  else
+    sqlite3_bind_null(event, 3);
+  sqlite3_bind_int64(event, 4, *category);
+  sqlite3_bind_int64(event, 5, *status);
+  sqlite3_bind_text(event, 6, row.details.data(), static_cast<int>(row.details.size()), SQLITE_STATIC);
+  sqlite3_bind_int64(event, 7, row.reported);
+  sqlite3_bind_int64(event, 8, row.updated);
+  if(!execute(event))
+    return false;
+
+  if(row.location) {
+    sqlite3_stmt* coordinates = statements.upsertCoordinates;
+    sqlite3_bind_text(coordinates, 1, row.id.data(), static_cast<int>(row.id.size()), SQLITE_STATIC);
+    sqlite3_bind_double(coordinates, 2, row.location->latitude);
+    sqlite3_bind_double(coordinates, 3, row.location->longitude);
+    return execute(coordinates);
+  }
+  // The event may have had coordinates in an earlier version
+  sqlite3_bind_text(statements.deleteCoordinates, 1, row.id.data(), static_cast<int>(row.id.size()), SQLITE_STATIC);
+  return execute(statements.deleteCoordinates);
+}
+
+// Apply a batch inside a single transaction, rolling back on any failure
+bool EventDatabase::apply(const PersistBatch& batch) {
+  if(!execute(statements.begin))
+    return false;
+  bool success = true;
+  if(batch.full)
+    success = execute(statements.clearCoordinates) && execute(statements.clearEvents);
+  for(const std::string& id : batch.deletes) {
+    if(!success)
+      break;
+    sqlite3_bind_text(statements.deleteCoordinates, 1, id.data(), static_cast<int>(id.size()), SQLITE_STATIC);
+    sqlite3_bind_text(statements.deleteEvent, 1, id.data(), static_cast<int>(id.size()), SQLITE_STATIC);
+    success = execute(statements.deleteCoordinates) && execute(statements.deleteEvent);
+  }
+  for(const EventRow& row : batch.upserts) {
+    if(!success)
+      break;
+    success = writeRow(row);
+  }
+  if(success && execute(statements.commit))
+    return true;
+
+  Output::logger.log(Output::LogLevel::ERROR, "DATABASE", "Failed to write batch: " + std::string(sqlite3_errmsg(db)));
+  execute(statements.rollback);
+  // IDs resolved inside the failed transaction were rolled back with it
+  roadwayIDs.clear();
+  categoryIDs.clear();
+  statusIDs.clear();
+  return false;
+}
+
+void EventDatabase::start() {
+  if(!db || writer.joinable())
+    return;
+  stopping = false;
+  writer = std::thread(&EventDatabase::writeLoop, this);
+}
+
+// Drain the queue and join the writer
+void EventDatabase::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueReady.notify_all();
+  if(writer.joinable())
+    writer.join();
+}
+
+// Copy the rows touched since the last capture
+// Each change only names the event, so its current version is read from the store while locked
+void EventDatabase::capture(const EventStore& store) {
+  if(!db)
+    return;
+  // The writer fell behind, a full rewrite replaces its backlog instead of adding to it
+  std::deque<PersistBatch> backlog;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if(queue.size() >= DATABASE_QUEUE_LIMIT)
+      backlog.swap(queue);
+  }
+  if(!backlog.empty()) {
+    resync = true;
+    std::string msg = "Database writer fell behind, dropped " + std::to_string(backlog.size()) + " batches for a full sync";
+    Output::logger.log(Output::LogLevel::WARN, "DATABASE", msg);
+    backlog.clear();
+  }
+  PersistBatch batch;
+  {
+    std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+    ChangeSet changes = store.changesSince(persistedSequence);
+    // Rewrite everything on the first capture, when the change log was outrun, or after a failed batch
+    if(changes.reset || resync.exchange(false)) {
+      batch.full = true;
+      for(const Event* event : store.select(std::nullopt, std::nullopt))
+        if(auto row = toRow(*event))
+          batch.upserts.push_back(std::move(*row));
+    } else {
+      for(const Change* change : changes.changes) {
+        if(change->type == ChangeType::Delete) {
+          batch.deletes.push_back(rowKey(change->source, change->id));
+        } else if(const Event* event = store.find(change->source, change->id)) {
+          if(auto row = toRow(*event))
+            batch.upserts.push_back(std::move(*row));
+          else
+            batch.deletes.push_back(rowKey(change->source, change->id));   // Moved out of every known market
+        }
+      }
+    }
+    persistedSequence = changes.sequence;
+  }
+  if(!batch.full && batch.upserts.empty() && batch.deletes.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.push_back(std::move(batch));
+  }
+  queueReady.notify_one();
+}
+
+// Apply queued batches off the ingestion thread
+void EventDatabase::writeLoop() {
+  while(true) {
+    PersistBatch batch;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueReady.wait(lock, [this]{ return stopping || !queue.empty(); });
+      if(queue.empty() && stopping)
+        break;
+      batch = std::move(queue.front());
+      queue.pop_front();
+    }
+    if(!apply(batch)) {
+      resync = true;
+      continue;
+    }
+    std::string msg = "Persisted " + std::to_string(batch.upserts.size()) + " events and removed "
+                    + std::to_string(batch.deletes.size()) + (batch.full ? " (full sync)" : "");
+    Output::logger.log(Output::LogLevel::DEBUG, "DATABASE", msg);
+  }
+}
+
+} // namespace Traffic
@@ -0,0 +1,239 @@
+#include "EventStore.h"
+#include "Traffic.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Traffic {
+
+// Hash the ID and mix in the source
+// The final avalanche step matters because the table indexes buckets by the low bits
+std::uint64_t EventStore::hashKey(DataSource source, std::string_view id) {
+  std::uint64_t hash = std::hash<std::string_view>{}(id);
+  hash ^= (static_cast<std::uint64_t>(source) + 1) * 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 30;
+  hash *= 0xBF58476D1CE4E5B9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94D049BB133111EBULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+// Microseconds since the UNIX epoch, a restarted process begins above any sequence the last one handed out
+// unless it made more than a million changes per second
+std::uint64_t EventStore::initialSequence() {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+std::string_view toString(const ChangeType& type) {
+  switch(type) {
+    case ChangeType::Insert:
+      return "insert";
+    case ChangeType::Update:
+      return "update";
+    case ChangeType::Delete:
+      return "delete";
+    default:
+      return "";
+  }
+}
+
+// Place an event in a free slot, growing the arrays if none are available
+EventStore::Handle EventStore::allocate(Event&& event) {
+  if(!freeSlots.empty()) {
+    Handle handle = freeSlots.back();
+    freeSlots.pop_back();
+    events[handle] = std::move(event);
+    slots[handle] = { events[handle].getSummary(), true };
+    return handle;
+  }
+  Handle handle = static_cast<Handle>(slots.size());
+  events.push_back(std::move(event));
+  slots.push_back({ events.back().getSummary(), true });
+  return handle;
+}
+
+// Add an event to each of its secondary indexes
+void EventStore::addToIndexes(Handle handle) {
+  const EventSummary& summary = slots[handle].summary;
+  regionBucket(summary.region).insert(handle);
+  sourceBucket(summary.dataSource).insert(handle);
+  pairBucket(summary.region, summary.dataSource).insert(handle);
+  // Events without coordinates can't be found by position
+  const Event& event = events[handle];
+  if(event.hasLocation())
+    spatialIndex.insert(handle, event.getLocation());
+}
+
+// Remove an event from each of its secondary indexes
+void EventStore::removeFromIndexes(Handle handle) {
+  const EventSummary& summary = slots[handle].summary;
+  regionBucket(summary.region).erase(handle);
+  sourceBucket(summary.dataSource).erase(handle);
+  pairBucket(summary.region, summary.dataSource).erase(handle);
+  spatialIndex.remove(handle);
+}
+
+// Replace a stored event, the event keeps its handle so only the index keys may change
+bool EventStore::update(DataSource source, std::string_view id, Event&& updated) {
+  auto found = keys.find(hashKey(source, id), matchesKey(source, id));
+  if(!found)
+    return false;
+  Handle handle = *found;
+  removeFromIndexes(handle);
+  // Hand the previous version off before it is overwritten
+  if(retireHandler)
+    retireHandler(std::move(events[handle]), ChangeType::Update);
+  events[handle] = std::move(updated);
+  if(storeHandler)
+    storeHandler(events[handle]);
+  slots[handle].summary = events[handle].getSummary();
+  addToIndexes(handle);
+  recordChange(ChangeType::Update, source, id);
+  return true;
+}
+
+// Remove an event and its index entries
+bool EventStore::erase(DataSource source, std::string_view id) {
+  // Drop the key while the stored ID is still available to verify against
+  auto found = keys.erase(hashKey(source, id), matchesKey(source, id));
+  if(!found)
+    return false;
+  Handle handle = *found;
+  removeFromIndexes(handle);
+  recordChange(ChangeType::Delete, source, id);
+  if(retireHandler)
+    retireHandler(std::move(events[handle]), ChangeType::Delete);
+  // Release the event's strings now rather than when the slot is reused
+  events[handle] = Event();
+  slots[handle].live = false;
+  freeSlots.push_back(handle);
+  return true;
+}
+
+// Find an event by key
+Event* EventStore::find(DataSource source, std::string_view id) {
+  auto found = keys.find(hashKey(source, id), matchesKey(source, id));
+  if(!found)
+    return nullptr;
+  return &events[*found];
+}
+
+const Event* EventStore::find(DataSource source, std::string_view id) const {
+  auto found = keys.find(hashKey(source, id), matchesKey(source, id));
+  if(!found)
+    return nullptr;
+  return &events[*found];
+}
+
+// Log a change, dropping the oldest entry once the log is full
+void EventStore::recordChange(ChangeType type, DataSource source, std::string_view id) {
+  Metrics::eventChanges.add(static_cast<std::size_t>(type));
+  if(changeLog.size() == CHANGE_LOG_CAPACITY)
+    changeLog.pop_front();
+  changeLog.push_back({ ++sequence, type, source, std::string(id) });
+  version.fetch_add(1, std::memory_order_release);
+}
+
+// Collect the changes after a sequence number
+ChangeSet EventStore::changesSince(std::uint64_t since) const {
+  ChangeSet result{ sequence, false, {} };
+  if(since == sequence)
+    return result;
+  // Changes between since and the oldest logged entry were evicted, or since came from before a restart
+  if(since > sequence || changeLog.empty() || since + 1 < changeLog.front().sequence) {
+    result.reset = true;
+    return result;
+  }
+  // Sequence numbers are contiguous, so the first wanted change can be found by offset
+  auto first = changeLog.begin() + static_cast<std::ptrdiff_t>(since + 1 - changeLog.front().sequence);
+  // Walk newest to oldest so only the latest change to each event is kept
+  // IDs are only unique within a source, so the source is part of the seen key
+  std::unordered_set<std::string> seen;
+  for(auto it = changeLog.end(); it != first;) {
+    --it;
+    std::string key = std::to_string(static_cast<int>(it->source)) + ':' + it->id;
+    if(seen.insert(std::move(key)).second)
+      result.changes.push_back(&*it);
+  }
+  // Return the changes oldest first
+  std::reverse(result.changes.begin(), result.changes.end());
+  return result;
+}
+
+// Choose the narrowest index for a set of filters
+// NOTE: At least one filter must be set
+const EventStore::IndexSet& EventStore::selectBucket(std::optional<Region> region, std::optional<DataSource> source) const {
+  if(region && source)
+    return pairIndex[static_cast<std::size_t>(*region) * SOURCE_COUNT + static_cast<std::size_t>(*source)];
+  if(region)
+    return regionIndex[static_cast<std::size_t>(*region)];
+  return sourceIndex[static_cast<std::size_t>(*source)];
+}
+
+// Retrieve all events matching the given filters
+std::vector<Event*> EventStore::select(std::optional<Region> region, std::optional<DataSource> source) {
+  std::vector<Event*> matches;
+  // No filters, return every live slot
+  if(!region && !source) {
+    matches.reserve(keys.size());
+    for(std::size_t handle = 0; handle < slots.size(); handle++)
+      if(slots[handle].live)
+        matches.push_back(&events[handle]);
+    return matches;
+  }
+  // Else read straight from the matching index
+  const IndexSet& bucket = selectBucket(region, source);
+  matches.reserve(bucket.size());
+  for(Handle handle : bucket)
+    matches.push_back(&events[handle]);
+  return matches;
+}
+
+std::vector<const Event*> EventStore::select(std::optional<Region> region, std::optional<DataSource> source) const {
+  std::vector<const Event*> matches;
+  if(!region && !source) {
+    matches.reserve(keys.size());
+    for(std::size_t handle = 0; handle < slots.size(); handle++)
+      if(slots[handle].live)
+        matches.push_back(&events[handle]);
+    return matches;
+  }
+  const IndexSet& bucket = selectBucket(region, source);
+  matches.reserve(bucket.size());
+  for(Handle handle : bucket)
+    matches.push_back(&events[handle]);
+  return matches;
+}
+
+// Apply the attribute filters to a set of spatial matches
+// The filters are checked against the hot array, only matching events are dereferenced
+std::vector<const Event*> EventStore::filter(const std::vector<Handle>& candidates, std::optional<Region> region, std::optional<DataSource> source) const {
+  std::vector<const Event*> matches;
+  matches.reserve(candidates.size());
+  for(Handle handle : candidates) {
+    const EventSummary& summary = slots[handle].summary;
+    if((region && summary.region != *region) || (source && summary.dataSource != *source))
+      continue;
+    matches.push_back(&events[handle]);
+  }
+  return matches;
+}
+
+// Retrieve events inside a bounding box
+std::vector<const Event*> EventStore::selectWithin(const BoundingBox& box, std::optional<Region> region, std::optional<DataSource> source) const {
+  return filter(spatialIndex.queryBox(box), region, source);
+}
+
+// Retrieve events within a radius of a point
+std::vector<const Event*> EventStore::selectNear(const Location& center, double radiusKm, std::optional<Region> region, std::optional<DataSource> source) const {
+  return filter(spatialIndex.queryRadius(center, radiusKm), region, source);
+}
+
+} // namespace Traffic
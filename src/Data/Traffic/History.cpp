@@ -0,0 +1,369 @@
+#include "History.h"
+#include "EventStore.h"
+#include "Output.h"
+#include "Traffic.h"
+#include "RestAPI.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Traffic {
+
+extern const std::string HISTORY_PATH{ "logs/history.bin" };
+HistoryLog eventHistory;
+
+namespace {
+
+constexpr std::uint64_t FILE_MAGIC{ 0x5452464849535431ULL };   // "TRFHIST1"
+constexpr std::uint32_t FILE_VERSION{ 1 };
+constexpr std::uint32_t RECORD_MAGIC{ 0x52454331 };              // "REC1"
+constexpr std::uint32_t WRAP_MAGIC{ 0x57524150 };                // "WRAP", the rest of the ring is unused
+
+// Records start on 8-byte boundaries
+constexpr std::size_t align(std::size_t size) { return (size + 7) & ~static_cast<std::size_t>(7); }
+
+} // namespace
+
+HistoryLog::~HistoryLog() {
+  stop();
+  if(mapping)
+    munmap(mapping, mappingSize);
+  if(fd >= 0)
+    close(fd);
+}
+
+std::uint64_t HistoryLog::dataStart() const {
+  return align(sizeof(FileHeader));
+}
+
+// Map the file, creating or resetting it when the existing header doesn't match
+bool HistoryLog::open(const std::string& path, std::size_t capacity) {
+  if(!Output::createDirIfMissing(path))
+    return false;
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd < 0) {
+    Output::logger.log(Output::LogLevel::ERROR, "HISTORY", "Failed to open history log: " + path);
+    return false;
+  }
+  struct stat info{};
+  bool existing = fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) == capacity;
+  if(!existing && ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+    Output::logger.log(Output::LogLevel::ERROR, "HISTORY", "Failed to size history log: " + path);
+    return false;
+  }
+  void* mapped = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mapped == MAP_FAILED) {
+    Output::logger.log(Output::LogLevel::ERROR, "HISTORY", "Failed to map history log: " + path);
+    return false;
+  }
+  mapping = static_cast<std::byte*>(mapped);
+  mappingSize = capacity;
+
+  FileHeader& file = header();
+  if(!existing || file.magic != FILE_MAGIC || file.version != FILE_VERSION || file.capacity != capacity) {
+    file = { FILE_MAGIC, FILE_VERSION, 0, capacity, dataStart(), dataStart(), 0 };
+    Output::logger.log(Output::LogLevel::INFO, "HISTORY", "Created history log: " + path);
+  } else if(!rebuildIndex()) {
+    file = { FILE_MAGIC, FILE_VERSION, 0, capacity, dataStart(), dataStart(), 0 };
+    order.clear();
+    versions.clear();
+    Output::logger.log(Output::LogLevel::WARN, "HISTORY", "Reset damaged history log: " + path);
+  } else {
+    std::string msg = "Opened history log with " + std::to_string(file.records) + " records: " + path;
+    Output::logger.log(Output::LogLevel::INFO, "HISTORY", msg);
+  }
+  return true;
+}
+
+void HistoryLog::start() {
+  if(!mapping || writer.joinable())
+    return;
+  stopping = false;
+  writer = std::thread(&HistoryLog::writeLoop, this);
+}
+
+// Drain the queue and join the writer
+void HistoryLog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueReady.notify_all();
+  if(writer.joinable())
+    writer.join();
+}
+
+void HistoryLog::retire(Event&& event, ChangeType reason) {
+  if(!mapping)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    // Keep the newest versions if the writer falls behind
+    if(queue.size() >= HISTORY_QUEUE_LIMIT) {
+      queue.pop_front();
+      dropped++;
+    }
+    queue.push_back({ std::move(event), reason, Time::toEpoch(Time::currentTime()) });
+  }
+  queueReady.notify_one();
+}
+
+// Get the record at an offset, following the wrap marker back to the start of the ring
+const HistoryLog::RecordHeader* HistoryLog::recordAt(std::uint64_t offset) const {
+  if(offset + sizeof(RecordHeader) > mappingSize)
+    offset = dataStart();
+  auto* record = reinterpret_cast<const RecordHeader*>(mapping + offset);
+  if(record->magic == WRAP_MAGIC)
+    record = reinterpret_cast<const RecordHeader*>(mapping + dataStart());
+  return record;
+}
+
+// Number a new record and index it under its event
+void HistoryLog::indexRecord(const RecordHeader& record, std::uint64_t offset) {
+  std::uint64_t sequence = firstSequence + order.size();
+  DataSource source = static_cast<DataSource>(record.source);
+  order.push_back({ offset, record.retiredAt, record.activeFrom, source });
+  const char* id = reinterpret_cast<const char*>(&record + 1);
+  versions[EventKey{ source, std::string(id, record.idLength) }].push_back(sequence);
+}
+
+// Walk the ring from the oldest record, as the index is not stored in the file
+// Lengths read from disk are checked before use, so a damaged record can't lead the walk outside the mapping
+bool HistoryLog::rebuildIndex() {
+  order.clear();
+  versions.clear();
+  firstSequence = 0;
+  const FileHeader& file = header();
+  if(file.tail < dataStart() || file.tail > mappingSize || file.head < dataStart() || file.head > mappingSize
+     || file.records > (mappingSize - dataStart()) / sizeof(RecordHeader))
+    return false;
+  std::uint64_t offset = file.tail;
+  for(std::uint64_t i = 0; i < file.records; i++) {
+    const RecordHeader* record = recordAt(offset);
+    offset = static_cast<std::uint64_t>(reinterpret_cast<const std::byte*>(record) - mapping);
+    if(record->magic != RECORD_MAGIC || record->source >= SOURCE_COUNT
+       || record->length < sizeof(RecordHeader) + record->idLength + record->payloadLength
+       || record->length > mappingSize - offset)
+      return false;
+    indexRecord(*record, offset);
+    offset += record->length;
+  }
+  return true;
+}
+
+// Drop the oldest record
+void HistoryLog::evictOldest() {
+  FileHeader& file = header();
+  const RecordHeader* record = recordAt(file.tail);
+  // The oldest record of an event is always the first one indexed under it
+  const char* id = reinterpret_cast<const char*>(record + 1);
+  auto found = versions.find(EventKey{ static_cast<DataSource>(record->source), std::string(id, record->idLength) });
+  if(found != versions.end()) {
+    found->second.erase(found->second.begin());
+    if(found->second.empty())
+      versions.erase(found);
+  }
+  if(!order.empty()) {
+    order.pop_front();
+    firstSequence++;
+  }
+  file.tail = static_cast<std::uint64_t>(reinterpret_cast<const std::byte*>(record) - mapping) + record->length;
+  file.records--;
+  if(file.records == 0)
+    file.tail = file.head;
+  // Keep the tail on a real record so the overlap checks in append() see its true position
+  else if(recordAt(file.tail) != reinterpret_cast<const RecordHeader*>(mapping + file.tail))
+    file.tail = dataStart();
+}
+
+// Write a record at the head of the ring, overwriting the oldest records as needed
+// NOTE: fileMutex must be held
+void HistoryLog::append(const Pending& pending) {
+  // Usually already cached by the API while the event was live
+  const std::string& payload = pending.event.getJSONFragment();
+  std::string_view id = pending.event.getID();
+  const EventSummary& summary = pending.event.getSummary();
+
+  std::size_t length = align(sizeof(RecordHeader) + id.size() + payload.size());
+  // A single record may use at most half of the ring
+  if(length > (mappingSize - dataStart()) / 2 || id.size() > UINT16_MAX) {
+    Output::logger.log(Output::LogLevel::WARN, "HISTORY", "Skipped oversized history record: " + std::string(id));
+    return;
+  }
+
+  FileHeader& file = header();
+  // Wrap to the start when the record doesn't fit before the end of the file
+  if(file.head + length > mappingSize) {
+    // Records between the head and the end are the oldest ones, drop them first
+    while(file.records && file.tail >= file.head)
+      evictOldest();
+    if(file.head + sizeof(RecordHeader) <= mappingSize)
+      reinterpret_cast<RecordHeader*>(mapping + file.head)->magic = WRAP_MAGIC;
+    file.head = dataStart();
+    if(file.records == 0)
+      file.tail = file.head;
+  }
+  // Drop any records the new one would overlap
+  while(file.records && file.tail >= file.head && file.tail < file.head + length)
+    evictOldest();
+
+  RecordHeader record{};
+  record.magic = RECORD_MAGIC;
+  record.length = static_cast<std::uint32_t>(length);
+  // Keep the ring in retirement order even if the clock steps back, queries rely on it
+  record.retiredAt = order.empty() ? pending.retiredAt : std::max(pending.retiredAt, order.back().retiredAt);
+  record.activeFrom = summary.timeReported ? summary.timeReported : summary.timeUpdated;
+  record.payloadLength = static_cast<std::uint32_t>(payload.size());
+  record.idLength = static_cast<std::uint16_t>(id.size());
+  record.source = static_cast<std::uint8_t>(summary.dataSource);
+  record.reason = static_cast<std::uint8_t>(pending.reason);
+
+  std::byte* position = mapping + file.head;
+  std::memcpy(position, &record, sizeof(record));
+  std::memcpy(position + sizeof(record), id.data(), id.size());
+  std::memcpy(position + sizeof(record) + id.size(), payload.data(), payload.size());
+  // Publish the record by advancing the header last
+  if(file.records == 0)
+    file.tail = file.head;
+  indexRecord(*reinterpret_cast<const RecordHeader*>(position), file.head);
+  file.head += length;
+  file.records++;
+}
+
+// Serialize queued events off the ingestion thread
+void HistoryLog::writeLoop() {
+  std::deque<Pending> batch;
+  while(true) {
+    std::size_t droppedCount{ 0 };
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueReady.wait(lock, [this]{ return stopping || !queue.empty(); });
+      if(queue.empty() && stopping)
+        break;
+      batch.swap(queue);
+      std::swap(droppedCount, dropped);
+    }
+    if(droppedCount) {
+      std::string msg = "History writer fell behind, dropped " + std::to_string(droppedCount) + " records";
+      Output::logger.log(Output::LogLevel::WARN, "HISTORY", msg);
+    }
+    {
+      std::lock_guard<std::mutex> lock(fileMutex);
+      for(const Pending& pending : batch)
+        append(pending);
+    }
+    // Let the kernel write the pages back in the background
+    msync(mapping, mappingSize, MS_ASYNC);
+    batch.clear();
+  }
+}
+
+// Walk the index from the newest record back, only reading the records which pass the filters
+// An ID is looked up directly, and the walk stops at the limit or the first record retired before the range
+std::vector<HistoryRecord> HistoryLog::query(const HistoryQuery& filters) const {
+  std::vector<HistoryRecord> matches;
+  if(!mapping || filters.limit == 0)
+    return matches;
+  std::lock_guard<std::mutex> lock(fileMutex);
+  // Copy a record out if it passes the filters, false once the remaining records are all too old
+  auto visit = [&](std::uint64_t sequence) {
+    const IndexEntry& entry = order[static_cast<std::size_t>(sequence - firstSequence)];
+    // Versions were active from their reported time until they were retired
+    if(filters.from && entry.retiredAt < *filters.from)
+      return false;
+    if((filters.to && entry.activeFrom > *filters.to) || (filters.source && entry.source != *filters.source))
+      return true;
+    const auto* record = reinterpret_cast<const RecordHeader*>(mapping + entry.offset);
+    const char* text = reinterpret_cast<const char*>(record + 1);
+    matches.push_back({ entry.retiredAt, static_cast<ChangeType>(record->reason), entry.source,
+                        std::string(text, record->idLength), std::string(text + record->idLength, record->payloadLength) });
+    return true;
+  };
+  if(filters.id) {
+    // IDs are only unique within a source, gather the event's records from each source asked for
+    std::vector<std::uint64_t> sequences;
+    EventKey key{ DataSource::UNKNOWN, *filters.id };
+    for(std::size_t i = 0; i < SOURCE_COUNT; i++) {
+      key.source = static_cast<DataSource>(i);
+      if(filters.source && key.source != *filters.source)
+        continue;
+      auto found = versions.find(key);
+      if(found != versions.end())
+        sequences.insert(sequences.end(), found->second.begin(), found->second.end());
+    }
+    std::sort(sequences.begin(), sequences.end(), std::greater<>());
+    for(std::uint64_t sequence : sequences)
+      if(matches.size() == filters.limit || !visit(sequence))
+        break;
+  } else {
+    for(std::uint64_t sequence = firstSequence + order.size(); sequence-- > firstSequence;)
+      if(matches.size() == filters.limit || !visit(sequence))
+        break;
+  }
+  // Collected newest first
+  std::reverse(matches.begin(), matches.end());
+  return matches;
+}
+
+// Read the history filters from the query, nullopt if any are invalid
+std::optional<HistoryQuery> parseHistoryQuery(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : queryParams) {
+    if(key != "id" && key != "source" && key != "from" && key != "to" && key != "limit")
+      return std::nullopt;
+  }
+  HistoryQuery filters;
+  if(auto idParam = RestAPI::findQueryParam(queryParams, "id"))
+    filters.id = *idParam;
+  if(auto sourceParam = RestAPI::findQueryParam(queryParams, "source"))
+    filters.source = toSource(*sourceParam);
+  // Time range in seconds since the UNIX epoch
+  if(auto fromParam = RestAPI::findQueryParam(queryParams, "from")) {
+    auto from = RestAPI::parseUnsigned(*fromParam);
+    if(!from)
+      return std::nullopt;
+    filters.from = static_cast<std::int64_t>(*from);
+  }
+  if(auto toParam = RestAPI::findQueryParam(queryParams, "to")) {
+    auto to = RestAPI::parseUnsigned(*toParam);
+    if(!to)
+      return std::nullopt;
+    filters.to = static_cast<std::int64_t>(*to);
+  }
+  if(auto limitParam = RestAPI::findQueryParam(queryParams, "limit")) {
+    auto limit = RestAPI::parseUnsigned(*limitParam);
+    if(!limit || *limit == 0 || *limit > HISTORY_QUERY_LIMIT)
+      return std::nullopt;
+    filters.limit = static_cast<std::size_t>(*limit);
+  }
+  return filters;
+}
+
+// Write the history matching a query
+// Stored payloads are already serialized events, they are copied into the output as they are
+void writeHistoryJSON(const HistoryQuery& filters, JSON::Writer& writer) {
+  writer.beginArray();
+  for(const HistoryRecord& record : eventHistory.query(filters)) {
+    // Payloads were written by us, skip any that are truncated
+    if(record.json.empty() || record.json.front() != '{' || record.json.back() != '}')
+      continue;
+    writer.beginObject();
+    writer.key("retired").value(Time::ISO6801::toString(Time::fromEpoch(record.retiredAt)));
+    writer.key("reason").value(record.reason == ChangeType::Delete ? "cleared" : "updated");
+    writer.key("event").raw(record.json);
+    writer.endObject();
+  }
+  writer.endArray();
+}
+
+} // namespace Traffic
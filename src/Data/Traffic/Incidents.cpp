@@ -0,0 +1,334 @@
+#include "Incidents.h"
+#include "EventStore.h"
+#include "RestAPI.h"
+#include "Traffic.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+IncidentIndex incidentIndex;
+
+namespace {
+
+// Grid cell size in degrees, at least INCIDENT_DISTANCE_KM wide across our markets so
+// every match lies in the same or a neighbouring cell
+constexpr double CELL_DEGREES{ 0.01 };
+
+std::int32_t toCell(double degrees) {
+  return static_cast<std::int32_t>(std::floor(degrees / CELL_DEGREES));
+}
+
+// Words which don't identify a road
+bool isNoise(const std::string& token) {
+  static const std::unordered_set<std::string> noise{
+    "N", "S", "E", "W", "NB", "SB", "EB", "WB", "NORTH", "SOUTH", "EAST", "WEST",
+    "NORTHBOUND", "SOUTHBOUND", "EASTBOUND", "WESTBOUND", "ST", "STREET", "AVE", "AVENUE",
+    "RD", "ROAD", "BLVD", "BOULEVARD", "DR", "DRIVE", "LN", "LANE", "PKWY", "PARKWAY",
+    "THE", "AT", "AND", "NEAR", "OF", "NA"
+  };
+  return noise.count(token) != 0;
+}
+
+// Split a road name into comparable tokens ("I-81 NB" and "Interstate 81" both become {I, 81})
+// Unknown roads ("N/A", the event default, or blank) have no tokens
+std::vector<std::string> normalizeRoad(std::string_view road) {
+  std::vector<std::string> tokens;
+  auto first = road.find_first_not_of(" \t");
+  if(first == std::string_view::npos)
+    return tokens;
+  road = road.substr(first, road.find_last_not_of(" \t") - first + 1);
+  if(road.size() == 3 && std::toupper(static_cast<unsigned char>(road[0])) == 'N' && road[1] == '/'
+     && std::toupper(static_cast<unsigned char>(road[2])) == 'A')
+    return tokens;
+  std::string token;
+  auto flush = [&]() {
+    if(token.empty())
+      return;
+    if(token == "INTERSTATE")
+      token = "I";
+    else if(token == "RT" || token == "RTE" || token == "ROUTE" || token == "SR" || token == "HWY" || token == "HIGHWAY")
+      token = "RT";
+    if(!isNoise(token))
+      tokens.push_back(std::move(token));
+    token.clear();
+  };
+  for(char c : road) {
+    unsigned char ch = static_cast<unsigned char>(c);
+    if(!std::isalnum(ch)) {
+      flush();
+      continue;
+    }
+    // Split at letter/digit boundaries so "I81" matches "I 81"
+    if(!token.empty() && (std::isdigit(ch) != 0) != (std::isdigit(static_cast<unsigned char>(token.back())) != 0))
+      flush();
+    token += static_cast<char>(std::toupper(ch));
+  }
+  flush();
+  std::sort(tokens.begin(), tokens.end());
+  tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+  return tokens;
+}
+
+bool isNumber(const std::string& token) {
+  return std::isdigit(static_cast<unsigned char>(token.front())) != 0;
+}
+
+// Road names match when most of the shorter name's tokens appear in the other
+// Route numbers must agree, "I-81" and "I-690" share a token but are different roads
+bool similarRoads(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+  std::vector<std::string> common;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+  bool aNumbered = std::any_of(a.begin(), a.end(), isNumber);
+  bool bNumbered = std::any_of(b.begin(), b.end(), isNumber);
+  if(aNumbered && bNumbered && std::none_of(common.begin(), common.end(), isNumber))
+    return false;
+  return common.size() * 2 >= std::min(a.size(), b.size());
+}
+
+} // namespace
+
+std::uint64_t IncidentIndex::bucketKey(std::int32_t x, std::int32_t y, std::int64_t t) {
+  std::uint64_t hash = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+  hash ^= static_cast<std::uint64_t>(t) * 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+// Different sources reporting nearby events on the same road at about the same time
+bool IncidentIndex::sameIncident(const Member& a, const Member& b) {
+  if(a.source == b.source || !a.located || !b.located)
+    return false;
+  if(std::llabs(a.time - b.time) > INCIDENT_WINDOW_SECONDS)
+    return false;
+  double distance = distanceKm(a.location, b.location);
+  if(a.road.empty() || b.road.empty())
+    return distance <= INCIDENT_UNNAMED_DISTANCE_KM;
+  return distance <= INCIDENT_DISTANCE_KM && similarRoads(a.road, b.road);
+}
+
+void IncidentIndex::add(const EventKey& key, const Event& event, std::uint64_t preferred) {
+  const EventSummary& summary = event.getSummary();
+  Member member;
+  member.source = key.source;
+  member.located = event.hasLocation();
+  member.location = event.getLocation();
+  member.time = summary.timeReported ? summary.timeReported : summary.timeUpdated;
+  EventFields fields = event.getFields();
+  member.road = normalizeRoad(fields.mainStreet);
+  member.bucket = member.located ? bucketKey(toCell(member.location.longitude), toCell(member.location.latitude),
+                                             member.time / INCIDENT_WINDOW_SECONDS) : 0;
+  member.incident = 0;
+  place(key, std::move(member), preferred);
+}
+
+// Check the 27 neighbouring buckets for matches, then join or merge their incidents
+void IncidentIndex::place(const EventKey& key, Member&& member, std::uint64_t preferred) {
+  std::vector<std::uint64_t> matched;
+  if(member.located) {
+    std::int32_t x = toCell(member.location.longitude), y = toCell(member.location.latitude);
+    std::int64_t t = member.time / INCIDENT_WINDOW_SECONDS;
+    for(std::int32_t dx = -1; dx <= 1; dx++) {
+      for(std::int32_t dy = -1; dy <= 1; dy++) {
+        for(std::int64_t dt = -1; dt <= 1; dt++) {
+          auto bucket = buckets.find(bucketKey(x + dx, y + dy, t + dt));
+          if(bucket == buckets.end())
+            continue;
+          for(const EventKey& candidate : bucket->second) {
+            const Member& other = members.at(candidate);
+            if(sameIncident(member, other) && std::find(matched.begin(), matched.end(), other.incident) == matched.end())
+              matched.push_back(other.incident);
+          }
+        }
+      }
+    }
+  }
+
+  std::uint64_t target;
+  if(matched.empty()) {
+    // Keep the ID an event or regrouped incident already had, so IDs stay stable across updates
+    target = preferred != 0 && incidents.count(preferred) == 0 ? preferred : nextIncident++;
+  } else {
+    // Keep the oldest incident and fold the others into it
+    target = *std::min_element(matched.begin(), matched.end());
+    for(std::uint64_t merged : matched) {
+      if(merged == target)
+        continue;
+      auto& targetKeys = incidents[target];
+      for(EventKey& moved : incidents[merged]) {
+        members.at(moved).incident = target;
+        targetKeys.push_back(std::move(moved));
+      }
+      incidents.erase(merged);
+    }
+  }
+  member.incident = target;
+  if(member.located)
+    buckets[member.bucket].push_back(key);
+  incidents[target].push_back(key);
+  members.insert_or_assign(key, std::move(member));
+}
+
+std::optional<IncidentIndex::Member> IncidentIndex::detach(const EventKey& key) {
+  auto found = members.find(key);
+  if(found == members.end())
+    return std::nullopt;
+  Member member = std::move(found->second);
+  members.erase(found);
+  // Order within buckets and incidents is irrelevant, swap and pop
+  auto erase = [&key](std::vector<EventKey>& keys) {
+    auto position = std::find(keys.begin(), keys.end(), key);
+    if(position != keys.end()) {
+      *position = std::move(keys.back());
+      keys.pop_back();
+    }
+  };
+  if(member.located) {
+    auto bucket = buckets.find(member.bucket);
+    if(bucket != buckets.end()) {
+      erase(bucket->second);
+      if(bucket->second.empty())
+        buckets.erase(bucket);
+    }
+  }
+  auto incident = incidents.find(member.incident);
+  if(incident != incidents.end()) {
+    erase(incident->second);
+    if(incident->second.empty())
+      incidents.erase(incident);
+  }
+  return member;
+}
+
+// Remove an event, regrouping the rest of its incident since it may have been the only link between them
+// The first group placed again keeps the incident's ID, only groups which split off get new ones
+std::uint64_t IncidentIndex::remove(const EventKey& key) {
+  auto removed = detach(key);
+  if(!removed)
+    return 0;
+  auto incident = incidents.find(removed->incident);
+  if(incident == incidents.end())
+    return removed->incident;
+  std::vector<EventKey> remaining = std::move(incident->second);
+  incidents.erase(incident);
+  std::vector<std::pair<EventKey, Member>> detached;
+  for(EventKey& other : remaining)
+    if(auto member = detach(other))
+      detached.emplace_back(std::move(other), std::move(*member));
+  for(auto& [other, member] : detached)
+    place(other, std::move(member), removed->incident);
+  return removed->incident;
+}
+
+void IncidentIndex::update(const EventStore& store) {
+  ChangeSet changes = store.changesSince(indexedSequence);
+  if(changes.reset) {
+    members.clear();
+    buckets.clear();
+    incidents.clear();
+    for(const Event* event : store.select(std::nullopt, std::nullopt))
+      add({ event->getSource(), std::string(event->getID()) }, *event);
+  } else {
+    for(const Change* change : changes.changes) {
+      EventKey key{ change->source, change->id };
+      std::uint64_t previous = remove(key);
+      if(change->type == ChangeType::Delete)
+        continue;
+      if(const Event* event = store.find(change->source, change->id))
+        add(key, *event, previous);
+    }
+  }
+  indexedSequence = changes.sequence;
+}
+
+// Serialize the incidents, each merging the events reported for it
+std::optional<std::string> serializeIncidentsToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : queryParams) {
+    if(key != "region" && key != "source")
+      return std::nullopt;
+  }
+  std::optional<Region> filterRegion{ std::nullopt };
+  std::optional<DataSource> filterSource{ std::nullopt };
+  if(auto regionParam = RestAPI::findQueryParam(queryParams, "region"))
+    filterRegion = toRegion(*regionParam);
+  if(auto sourceParam = RestAPI::findQueryParam(queryParams, "source"))
+    filterSource = toSource(*sourceParam);
+
+  JSON::Writer writer;
+  writer.beginArray();
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+  const EventStore& store = mapEvents;
+  incidentIndex.forEach([&](std::uint64_t id, const std::vector<EventKey>& keys) {
+    std::vector<const Event*> events;
+    events.reserve(keys.size());
+    for(const EventKey& key : keys)
+      if(const Event* event = store.find(key.source, key.id))
+        events.push_back(event);
+    if(events.empty())
+      return;
+    // Match the filters against any contributing event
+    if(filterRegion && std::none_of(events.begin(), events.end(), [&](const Event* e){ return e->getRegion() == *filterRegion; }))
+      return;
+    if(filterSource && std::none_of(events.begin(), events.end(), [&](const Event* e){ return e->getSource() == *filterSource; }))
+      return;
+
+    // Describe the incident by its most recently updated report
+    const Event* latest = *std::max_element(events.begin(), events.end(), [](const Event* a, const Event* b){
+      return a->getUpdatedTime() < b->getUpdatedTime();
+    });
+    writer.beginObject();
+    writer.key("id").value(id);
+    writer.key("event").raw(latest->getJSONFragment());
+
+    std::int64_t reported = std::numeric_limits<std::int64_t>::max();
+    double latitude{ 0.0 }, longitude{ 0.0 };
+    int located{ 0 };
+    writer.key("sources").beginArray();
+    for(const Event* event : events) {
+      writer.beginObject();
+      writer.key("source").nullable(sourceName(event->getSource()));
+      writer.key("id").value(event->getID());
+      writer.endObject();
+      const EventSummary& summary = event->getSummary();
+      if(summary.timeReported)
+        reported = std::min(reported, summary.timeReported);
+      if(event->hasLocation()) {
+        latitude += event->getLocation().latitude;
+        longitude += event->getLocation().longitude;
+        located++;
+      }
+    }
+    writer.endArray();
+    // First report from any source, and the centre of the reported positions
+    writer.key("reported");
+    if(reported != std::numeric_limits<std::int64_t>::max())
+      writer.value(Time::ISO6801::toString(Time::fromEpoch(reported)));
+    else
+      writer.null();
+    writer.key("coordinates").beginObject();
+    if(located) {
+      writer.key("lat").value(latitude / located);
+      writer.key("long").value(longitude / located);
+    } else {
+      writer.key("lat").null();
+      writer.key("long").null();
+    }
+    writer.endObject();
+    writer.endObject();
+  });
+  writer.endArray();
+  return writer.release();
+}
+
+} // namespace Traffic
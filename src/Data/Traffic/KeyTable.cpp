@@ -0,0 +1,58 @@
+#include "KeyTable.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Traffic {
+
+// Capacity is always a power of two so probing can mask rather than divide
+KeyTable::KeyTable(std::size_t initialCapacity)
+: buckets(std::bit_ceil(initialCapacity < 8 ? std::size_t{ 8 } : initialCapacity))
+{}
+
+void KeyTable::insert(std::uint64_t hash, Handle handle) {
+  // Keep the load factor at or below 3/4 so probe sequences stay short
+  if((count + 1) * 4 > buckets.size() * 3)
+    grow();
+  std::size_t i = hash & mask();
+  while(buckets[i].handle != EMPTY)
+    i = (i + 1) & mask();
+  buckets[i] = { hash, handle };
+  count++;
+}
+
+// Double the bucket array and re-insert every entry
+void KeyTable::grow() {
+  std::vector<Bucket> previous = std::move(buckets);
+  buckets.assign(previous.size() * 2, Bucket{});
+  for(const Bucket& bucket : previous) {
+    if(bucket.handle == EMPTY)
+      continue;
+    std::size_t i = bucket.hash & mask();
+    while(buckets[i].handle != EMPTY)
+      i = (i + 1) & mask();
+    buckets[i] = bucket;
+  }
+}
+
+// Empty a bucket and shift back any later entries whose probe sequence passed through it
+void KeyTable::removeAt(std::size_t position) {
+  std::size_t hole = position;
+  for(std::size_t i = (hole + 1) & mask(); buckets[i].handle != EMPTY; i = (i + 1) & mask()) {
+    std::size_t home = buckets[i].hash & mask();
+    // Distance from each entry's home bucket, wrapping around the end of the array
+    std::size_t distanceToHole = (hole - home) & mask();
+    std::size_t distanceToEntry = (i - home) & mask();
+    // The entry can fill the hole if the hole lies between its home and its current bucket
+    if(distanceToHole < distanceToEntry) {
+      buckets[hole] = buckets[i];
+      hole = i;
+    }
+  }
+  buckets[hole] = Bucket{};
+  count--;
+}
+
+} // namespace Traffic
@@ -1,7 +1,10 @@
 #include "MCNY.h"
 #include "Output.h"
 #include "Traffic.h"
+#include "EventStore.h"
+#include "Arena.h"
 
+#include <memory_resource>
 #include <string>
 #include <regex>
 #include <tuple>
@@ -16,14 +19,16 @@ bool processEvent(rapidxml::xml_node<>* parsedEvent) {
   // Extract Status and ID as a pair
   std::pair<std::string, std::string> description = parseDescription(parsedEvent->first_node("description"));
   auto& [status, key] = description;
-  processedKeys.push_back(key);
+  processedKeys.insert({ DataSource::MCNY, key });
 
   // Try to insert a new Event at event, inserted = false if it already exists
-  auto [event, inserted] = mapEvents.try_emplace(key, parsedEvent, description);
+  auto [event, inserted] = mapEvents.tryEmplace(DataSource::MCNY, key, parsedEvent, description);
   // Check if we added a new event
   if(!inserted) {
-    if(event->second.getStatus() != status) {
-      event->second = Event(parsedEvent, description);
+    // Compare the parsed status against the stored one
+    EventStatus parsedStatus = toStatus(status);
+    if(event->getStatus() != parsedStatus || (parsedStatus == EventStatus::OTHER && event->getStatusText() != status)) {
+      mapEvents.update(DataSource::MCNY, key, Event(parsedEvent, description));
       std::string msg = "Updated event: " + key;
       Output::logger.log(Output::LogLevel::INFO, "MCNY", msg);
       return true;
@@ -52,10 +57,11 @@ std::pair<std::string, std::string> parseDescription(rapidxml::xml_node<>* descr
 }
 
 // Process Title data element into event title, main street, direction (optional), and cross-street (optional) elements
-std::optional<std::tuple<std::string, std::string, std::optional<std::string>, std::optional<std::string>>> processTitle(const std::string& title) {
-  // Define the matching pattern
-  std::regex pattern(R"(^(.+?) at\s+(?:\d+-?BLK\s+)?(?:\d+\s+)?@?((?:RR\s+|RT\s+)?(?:INNER\s+(EB|WB|NB|SB)\s+LOOP|LAKE\s+ONTARIO\s+(EB|WB|NB|SB)\s+STPK|[A-Z0-9]+)(?:\s+(?!(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER)\b)(?!NB\b|SB\b|EB\b|WB\b)(?!MM\b)[A-Z0-9]+)*(?:\s+RD|ST|AVE|BLVD|PKWY|TRL|DR)?)(?:\s+(NB|SB|EB|WB))?(?:\s+MM\s+\d+(?:\.\d+)?)?(?:/(.+?))?(?:\s+(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER)(?:\s+(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER))?)?\s*(?:\([^)]*\))?\s*(?:EASTSIDE\s+RR)?(?::.*)?$)");
-  std::smatch matches;
+std::optional<titleStr> processTitle(const std::string& title) {
+  // Define the matching pattern, compiled once rather than on every event
+  static const std::regex pattern(R"(^(.+?) at\s+(?:\d+-?BLK\s+)?(?:\d+\s+)?@?((?:RR\s+|RT\s+)?(?:INNER\s+(EB|WB|NB|SB)\s+LOOP|LAKE\s+ONTARIO\s+(EB|WB|NB|SB)\s+STPK|[A-Z0-9]+)(?:\s+(?!(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER)\b)(?!NB\b|SB\b|EB\b|WB\b)(?!MM\b)[A-Z0-9]+)*(?:\s+RD|ST|AVE|BLVD|PKWY|TRL|DR)?)(?:\s+(NB|SB|EB|WB))?(?:\s+MM\s+\d+(?:\.\d+)?)?(?:/(.+?))?(?:\s+(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER)(?:\s+(?:SWE|ROC|BRI|IRO|HEN|PEN|NYSP|MSO|PIT|GAT|HAM|CHI|WBT|GRE|OGD|HIL|BRO|PER))?)?\s*(?:\([^)]*\))?\s*(?:EASTSIDE\s+RR)?(?::.*)?$)");
+  // Match storage comes from the parse arena
+  std::match_results<std::string::const_iterator, Arena::Allocator<std::ssub_match>> matches{ Arena::resource() };
   /*
    *    matches[1] = event title
    *    matches[2] = mainStreet
@@ -68,36 +74,30 @@ std::optional<std::tuple<std::string, std::string, std::optional<std::string>, s
    */
   
   if (std::regex_search(title, matches, pattern)) {
+    // Copy a capture group into the arena
+    auto capture = [&matches](std::size_t group) {
+      return std::pmr::string(matches[group].first, matches[group].second, Arena::resource());
+    };
 
     // Extract the street name and direction
-    std::string streetName{ matches[2] };
-    bool hasCross{ matches[6].matched };  // check if we matched a cross-street
+    std::pmr::string streetName{ capture(2) };
+    std::optional<std::pmr::string> direction;
+    std::optional<std::pmr::string> cross;
+    if(matches[6].matched)              // check if we matched a cross-street
+      cross = capture(6);
 
     if(matches[3].matched) {            // Inner Loop logic
       if(streetName.find("INNER") != std::string::npos)
         streetName = "INNER LOOP";
-      if(hasCross)
-        return std::make_tuple(matches[1], streetName, matches[3], matches[6]);
-      else 
-        return std::make_tuple(matches[1], streetName, matches[3], std::nullopt);
+      direction = capture(3);
     } else if(matches[4].matched) {     // LOSP logic
       if(streetName.find("LAKE ONTARIO") != std::string::npos)
         streetName = "LAKE ONTARIO STPKWY";
-      if(hasCross)
-        return std::make_tuple(matches[1], streetName, matches[4], matches[6]);
-      else
-        return std::make_tuple(matches[1], streetName, matches[4], std::nullopt);
+      direction = capture(4);
     } else if(matches[5].matched) {     // Defualt case logic
-      if(hasCross)
-        return std::make_tuple(matches[1], streetName, matches[5], matches[6]);
-      else
-        return std::make_tuple(matches[1], streetName, matches[5], std::nullopt);
-    } else {
-      if(hasCross)
-        return std::make_tuple(matches[1], streetName, std::nullopt, matches[6]); 
-      else
-        return std::make_tuple(matches[1], streetName, std::nullopt, std::nullopt); 
+      direction = capture(5);
     }
+    return titleStr{ capture(1), std::move(streetName), std::move(direction), std::move(cross) };
   }
   std::string errMsg = "MCNY title does not match (\"" + title + "\")";
   Output::logger.log(Output::LogLevel::WARN, "REGEX", errMsg);
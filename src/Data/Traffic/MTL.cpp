@@ -1,5 +1,6 @@
 #include "MTL.h"
 #include "Traffic.h"
+#include "EventStore.h"
 #include "Output.h"
 #include <rapidxml.hpp>
 #include <string>
@@ -34,11 +35,11 @@ bool processEvent(rapidxml::xml_node<>* parsedEvent) {
     return false;
   }
 
-  processedKeys.push_back(id);
+  processedKeys.insert({ DataSource::MTL, id });
   
   // Add the event to the map
   // Try to insert a new Event at event, inserted = false if it already exists
-  auto [event, inserted] = mapEvents.try_emplace(id, parsedEvent);
+  auto [event, inserted] = mapEvents.tryEmplace(DataSource::MTL, id, parsedEvent);
   if(inserted)
     return true;
 
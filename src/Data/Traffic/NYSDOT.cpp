@@ -13,6 +13,10 @@ std::string API_KEY{""};
 extern const std::string EVENTS_URL{ "https://511ny.org/api/getevents?format=json&key=" };
 extern const std::string CAMERAS_URL{ "https://511ny.org/api/getcameras?format=json&key=" };
 extern constexpr BoundingBox regionSyracuse{ -76.562, -75.606, 43.553, 42.621 };
+extern constexpr BoundingBox regionRochester{ -78.250, -76.950, 43.380, 42.700 };
+extern constexpr BoundingBox regionBuffalo{ -79.300, -78.400, 43.300, 42.600 };
+extern constexpr BoundingBox regionAlbany{ -74.300, -73.400, 43.200, 42.400 };
+extern constexpr BoundingBox regionBinghamton{ -76.400, -75.400, 42.400, 41.950 };
 
 // Source data from local environment
 void getEnv() {
@@ -53,5 +57,21 @@ Region getRegion(const std::string& regionName) {
     return Region::UNKNOWN;
 }
 
+// Find the market containing a location, for sources which only report coordinates
+Region getRegion(const Location& location) {
+  if(regionSyracuse.contains(location))
+    return Region::Syracuse;
+  else if(regionRochester.contains(location))
+    return Region::Rochester;
+  else if(regionBuffalo.contains(location))
+    return Region::Buffalo;
+  else if(regionAlbany.contains(location))
+    return Region::Albany;
+  else if(regionBinghamton.contains(location))
+    return Region::Binghamton;
+  else
+    return Region::UNKNOWN;
+}
+
 }
 }
@@ -2,8 +2,10 @@
 #include "DataUtils.h"
 #include "Output.h"
 #include "Traffic.h"
+#include "Arena.h"
 #include <cassert>
 #include <gumbo.h>
+#include <memory_resource>
 #include <regex>
 #include <string>
 #include <utility>
@@ -61,7 +63,7 @@ bool postRequest(const std::string& url, int numPages, cURL::Handle& curlHandle)
 
 namespace Gumbo {
 // Parse data from HTML string
-std::optional<std::vector<HTML::Event>>parseData(const std::string& htmlData) {
+std::optional<HTML::EventList> parseData(const std::string& htmlData) {
   HTML::GumboOutputWrapper output(htmlData);
 
   if(!output) {
@@ -100,7 +102,7 @@ std::optional<std::vector<HTML::Event>>parseData(const std::string& htmlData) {
   // Process each matching table in the vector (there should only be one)
   for(GumboNode* table : tables) {
     if(auto events = processTable(table)) {
-      return *events;
+      return std::move(*events);  // Move so the rows stay in the arena
     }
   }
   return std::nullopt;
@@ -136,10 +138,10 @@ void searchForTable(GumboNode* rootNode, const std::string& targetClass, std::ve
 }
 
 // Process a found table to extract data
-std::optional<std::vector<HTML::Event>> processTable(GumboNode* tableNode) {
+std::optional<HTML::EventList> processTable(GumboNode* tableNode) {
 
   // Create a vector to store our row vectors in
-  std::vector<HTML::Event> tableData;
+  HTML::EventList tableData{ Arena::resource() };
 
   // Iterate over each child node and look for table rows '<tr>'
   GumboElement* table = &tableNode->v.element;
@@ -176,7 +178,7 @@ std::optional<std::vector<HTML::Event>> processTable(GumboNode* tableNode) {
 }
 
 // Process a table row into an Event and place on the vector
-void processRow(GumboElement* tableRow, std::vector<HTML::Event>& eventsVector) {
+void processRow(GumboElement* tableRow, HTML::EventList& eventsVector) {
   // Create an empty event
   HTML::Event event;
 
@@ -231,7 +233,7 @@ void processRow(GumboElement* tableRow, std::vector<HTML::Event>& eventsVector)
   if(event.title != "") {
     // Create an ID
     event.createID();
-    eventsVector.push_back(event);
+    eventsVector.push_back(std::move(event));
   }
 }
 
@@ -256,8 +258,8 @@ std::string getFirstSpanId(GumboElement* tableData) {
 }
 
 // Extract data from the table data element into the reference string
-void getData(GumboElement* tableData, std::string& element) {
-  std::string data;
+void getData(GumboElement* tableData, std::pmr::string& element) {
+  std::pmr::string data{ Arena::resource() };
   // Iterate through each child (<span>) object of our table data
   for(size_t i = 0; i < tableData->children.length; ++i) {
     GumboNode* spanNode = static_cast<GumboNode*>(tableData->children.data[i]);
@@ -284,13 +286,14 @@ void getData(GumboElement* tableData, std::string& element) {
     // Trim whitespace
     trim(data);
     // Store the extracted string in the data element
-    element = data;
+    element = std::move(data);
   }
 }
 
 // Parse an address table data element into its sub-elements
 void getAddressData(GumboElement* tableData, HTML::Event& event) {
-  std::string dirPre, name, suff, dirPost, details;
+  std::pmr::string dirPre{ Arena::resource() }, name{ Arena::resource() }, suff{ Arena::resource() };
+  std::pmr::string dirPost{ Arena::resource() }, details{ Arena::resource() };
   // Iterate through each child (<span>) object of our table data
   for(size_t i = 0; i < tableData->children.length; ++i) {
     GumboNode* spanNode = static_cast<GumboNode*>(tableData->children.data[i]);
@@ -352,7 +355,7 @@ void getAddressData(GumboElement* tableData, HTML::Event& event) {
 
 // Parse an cross street table data element into its sub-elements
 void getCrossData(GumboElement* tableData, HTML::Event& event) {
-  std::string street1, street2, join;
+  std::pmr::string street1{ Arena::resource() }, street2{ Arena::resource() }, join{ Arena::resource() };
   // Iterate through each child (<span>) object of our table data
   for(size_t i = 0; i < tableData->children.length; ++i) {
     GumboNode* spanNode = static_cast<GumboNode*>(tableData->children.data[i]);
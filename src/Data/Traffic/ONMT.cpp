@@ -1,6 +1,8 @@
 #include "ONMT.h"
 #include "DataUtils.h"
 #include "Output.h"
+#include "Arena.h"
+#include <memory_resource>
 #include <string>
 #include <optional>
 #include <tuple>
@@ -13,18 +15,18 @@ extern constexpr BoundingBox regionToronto{ -80.099, -78.509, 44.205, 43.137 };
 extern constexpr BoundingBox regionOttawa{ -76.053, -75.089, 45.759, 45.040 };
 
 // Parse a description into an event title, main street, and cross street
-std::optional<std::tuple<std::string, std::string, std::string>> parseDescription(const std::string& description) {
-  // Define the matching pattern
-  std::regex pattern(R"((.+?)\s+on\s+(.+?)\s+at\s+(.+?),)"); // 1 - Title | 2 - mainStreet | 3 - crossStreet 
-  std::smatch matches;
+std::optional<std::tuple<std::pmr::string, std::pmr::string, std::pmr::string>> parseDescription(const std::string& description) {
+  // Define the matching pattern, compiled once rather than on every event
+  static const std::regex pattern(R"((.+?)\s+on\s+(.+?)\s+at\s+(.+?),)"); // 1 - Title | 2 - mainStreet | 3 - crossStreet 
+  std::match_results<std::string::const_iterator, Arena::Allocator<std::ssub_match>> matches{ Arena::resource() };
 
   if(std::regex_search(description, matches, pattern)) {
-    // Extract our values
-    std::string eventTitle = matches[1];
-    std::string eventStreet = matches[2];
-    std::string eventCross = matches[3];
+    // Extract our values into the parse arena
+    std::pmr::string eventTitle(matches[1].first, matches[1].second, Arena::resource());
+    std::pmr::string eventStreet(matches[2].first, matches[2].second, Arena::resource());
+    std::pmr::string eventCross(matches[3].first, matches[3].second, Arena::resource());
 
-    return std::make_tuple(eventTitle, eventStreet, eventCross);
+    return std::make_tuple(std::move(eventTitle), std::move(eventStreet), std::move(eventCross));
   }
 
   std::string errMsg = "ONMT description does not match (\"" + description + "\")";
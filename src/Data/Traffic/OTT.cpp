@@ -1,5 +1,7 @@
 #include "OTT.h"
 #include "DataUtils.h"
+#include "Arena.h"
+#include <memory_resource>
 #include <optional>
 #include <iostream>
 #include <sstream>
@@ -40,21 +42,17 @@ std::optional<std::pair<double, double>> parseLocation(const std::string& coordi
 }
 
 std::optional<roadwayStr> parseHeadline(const std::string& headline) {
-  std::regex pattern(R"((\S+(?:\s\S+)*?)\s*([A-Za-z/]+)?\s*(?:at\s*(.*)))");
+  static const std::regex pattern(R"((\S+(?:\s\S+)*?)\s*([A-Za-z/]+)?\s*(?:at\s*(.*)))");
 
-  std::smatch matches;
+  // Match storage and captures come from the parse arena
+  std::match_results<std::string::const_iterator, Arena::Allocator<std::ssub_match>> matches{ Arena::resource() };
   if(std::regex_match(headline, matches, pattern)) {
-    if(matches[2].matched) {
-      if(matches[3].matched)
-        return std::make_tuple(matches[1], matches[2], matches[3]);
-      else
-        return std::make_tuple(matches[1], matches[2], std::nullopt);
-    } else {
-      if(matches[3].matched)
-        return std::make_tuple(matches[1], std::nullopt, matches[3]);
-      else
-        return std::make_tuple(matches[1], std::nullopt, std::nullopt);
-    }
+    auto capture = [&matches](std::size_t group) -> std::optional<std::pmr::string> {
+      if(!matches[group].matched)
+        return std::nullopt;
+      return std::pmr::string(matches[group].first, matches[group].second, Arena::resource());
+    };
+    return roadwayStr{ *capture(1), capture(2), capture(3) };
   }
   return std::nullopt;
 }
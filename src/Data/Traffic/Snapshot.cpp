@@ -0,0 +1,182 @@
+#include "Snapshot.h"
+#include "EventStore.h"
+#include "Output.h"
+#include "Traffic.h"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Traffic {
+
+extern const std::string SNAPSHOT_PATH{ "logs/snapshot.bin" };
+
+namespace {
+
+constexpr std::uint64_t FILE_MAGIC{ 0x5452465350415431ULL };   // "TRFSPAT1"
+constexpr std::uint32_t FILE_VERSION{ 1 };
+constexpr std::size_t STRING_COUNT{ 8 };
+
+struct FileHeader {
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t recordSize;       // Guards against layout changes between builds
+  std::uint64_t count;            // Number of records
+  std::uint64_t stringBytes;      // Size of the string block following the records
+  std::int64_t createdAt;         // Seconds since the UNIX epoch
+};
+
+// Fixed size record, strings are stored as (offset, length) into the string block
+struct Record {
+  EventSummary summary;
+  double latitude;
+  double longitude;
+  std::array<std::uint32_t, STRING_COUNT> offsets;
+  std::array<std::uint32_t, STRING_COUNT> lengths;
+};
+
+// Order of the strings within a record
+std::array<std::string_view, STRING_COUNT> stringsOf(const EventFields& fields) {
+  return { fields.id, fields.url, fields.title, fields.statusText, fields.directionText,
+           fields.mainStreet, fields.crossStreet, fields.description };
+}
+
+// Write a whole buffer, retrying short writes
+bool writeAll(int fd, const char* data, std::size_t size) {
+  while(size) {
+    ssize_t written = ::write(fd, data, size);
+    if(written < 0)
+      return false;
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+// Reject records whose enums are out of range, they are used as index positions
+bool validSummary(const EventSummary& summary) {
+  return summary.dataSource <= DataSource::UNKNOWN && summary.region <= Region::UNKNOWN
+      && summary.status <= EventStatus::OTHER && summary.direction <= Direction::OTHER;
+}
+
+} // namespace
+
+// Encode the store into a single buffer, then write it out once the lock is released
+bool saveSnapshot(const EventStore& store, const std::string& path) {
+  std::vector<char> buffer;
+  std::string strings;
+  {
+    std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+    std::vector<const Event*> events = store.select(std::nullopt, std::nullopt);
+    buffer.resize(sizeof(FileHeader) + events.size() * sizeof(Record));
+    char* position = buffer.data() + sizeof(FileHeader);
+    for(const Event* event : events) {
+      EventFields fields = event->getFields();
+      Record record{};
+      record.summary = fields.summary;
+      record.latitude = fields.location.latitude;
+      record.longitude = fields.location.longitude;
+      auto values = stringsOf(fields);
+      for(std::size_t i = 0; i < STRING_COUNT; i++) {
+        record.offsets[i] = static_cast<std::uint32_t>(strings.size());
+        record.lengths[i] = static_cast<std::uint32_t>(values[i].size());
+        strings.append(values[i]);
+      }
+      std::memcpy(position, &record, sizeof(record));
+      position += sizeof(record);
+    }
+    FileHeader header{ FILE_MAGIC, FILE_VERSION, sizeof(Record), events.size(), strings.size(),
+                       Time::toEpoch(Time::currentTime()) };
+    std::memcpy(buffer.data(), &header, sizeof(header));
+  }
+
+  // Write to a temporary file and rename it over the old snapshot so a crash never leaves a partial file
+  if(!Output::createDirIfMissing(path))
+    return false;
+  std::string tempPath = path + ".tmp";
+  int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
+    Output::logger.log(Output::LogLevel::ERROR, "SNAPSHOT", "Failed to open snapshot: " + tempPath);
+    return false;
+  }
+  bool written = writeAll(fd, buffer.data(), buffer.size()) && writeAll(fd, strings.data(), strings.size()) && fsync(fd) == 0;
+  close(fd);
+  if(!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    Output::logger.log(Output::LogLevel::ERROR, "SNAPSHOT", "Failed to write snapshot: " + path);
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Map the snapshot read-only and rebuild each event from its record
+// Every offset is checked against the file size before it is read
+std::size_t loadSnapshot(EventStore& store, const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    return 0;
+  struct stat info{};
+  if(fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(FileHeader)) {
+    close(fd);
+    return 0;
+  }
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapped == MAP_FAILED) {
+    Output::logger.log(Output::LogLevel::ERROR, "SNAPSHOT", "Failed to map snapshot: " + path);
+    return 0;
+  }
+  const char* data = static_cast<const char*>(mapped);
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  std::size_t recordsEnd = sizeof(FileHeader) + header.count * sizeof(Record);
+  bool valid = header.magic == FILE_MAGIC && header.version == FILE_VERSION && header.recordSize == sizeof(Record)
+            && header.count <= (size - sizeof(FileHeader)) / sizeof(Record) && recordsEnd + header.stringBytes == size;
+  if(!valid) {
+    Output::logger.log(Output::LogLevel::WARN, "SNAPSHOT", "Ignored invalid snapshot: " + path);
+    munmap(mapped, size);
+    return 0;
+  }
+
+  const char* strings = data + recordsEnd;
+  std::size_t restored{ 0 };
+  {
+    std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+    for(std::uint64_t i = 0; i < header.count; i++) {
+      Record record;
+      std::memcpy(&record, data + sizeof(FileHeader) + i * sizeof(Record), sizeof(record));
+      std::array<std::string_view, STRING_COUNT> values;
+      bool inBounds = true;
+      for(std::size_t j = 0; j < STRING_COUNT && inBounds; j++) {
+        inBounds = static_cast<std::uint64_t>(record.offsets[j]) + record.lengths[j] <= header.stringBytes;
+        if(inBounds)
+          values[j] = std::string_view(strings + record.offsets[j], record.lengths[j]);
+      }
+      if(!inBounds || values[0].empty() || !validSummary(record.summary))
+        continue;
+      EventFields fields{ record.summary, Location(record.latitude, record.longitude), values[0], values[1], values[2],
+                          values[3], values[4], values[5], values[6], values[7] };
+      if(store.tryEmplace(fields.summary.dataSource, fields.id, fields).second)
+        restored++;
+    }
+  }
+  munmap(mapped, size);
+
+  std::string msg = "Restored " + std::to_string(restored) + " events from snapshot taken at "
+                  + Time::ISO6801::toString(Time::fromEpoch(header.createdAt));
+  Output::logger.log(Output::LogLevel::INFO, "SNAPSHOT", msg);
+  return restored;
+}
+
+} // namespace Traffic
@@ -1,4 +1,6 @@
 #include "Traffic.h"
+#include "EventStore.h"
+#include "CameraStore.h"
 #include "NYSDOT.h"
 #include "MCNY.h"
 #include "ONMT.h"
@@ -8,16 +10,24 @@
 #include "DataUtils.h"
 #include "Output.h"
 #include "RestAPI.h"
+#include "Arena.h"
 #include "rapidxml.hpp"
 #include <chrono>
 #include <json/value.h>
+#include <array>
 #include <optional>
 #include <mutex>    
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <cctype>
+#include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <climits>
+#include <sstream>
 #include <unordered_map>
+#include <utility>
 
 /* TODO:
  *
@@ -70,14 +80,15 @@
 namespace Traffic { 
 
 // Data structures
-std::mutex eventsMutex;
-std::unordered_map<std::string, Event> mapEvents;
-std::unordered_map<std::string, Camera> mapCameras;
-std::vector<std::string> processedKeys;
+Metrics::TimedMutex eventsMutex{ Metrics::eventsLockWait, Metrics::eventsLockHold };
+EventStore mapEvents;
+std::unordered_set<EventKey, EventKeyHash> processedKeys;
 std::vector<DataSource> extractedSources;
 
 // Static object to store data source for current iteration
 DataSource currentSource;
+// Parse arena size for each source, grown to the largest cycle seen so far
+std::array<std::size_t, SOURCE_COUNT> arenaSizes{};
 //std::string currentCookie;
 
 Region toRegion(const std::string& regionStr) {
@@ -145,6 +156,114 @@ DataSource toSource(const std::string& sourceStr) {
   return DataSource::UNKNOWN;
 }
 
+// Convert a status to its display string
+std::string_view toString(const EventStatus& status) {
+  switch(status) {
+    case EventStatus::Active:
+      return "Active";
+    case EventStatus::Dispatched:
+      return "Dispatched";
+    case EventStatus::EnRoute:
+      return "En Route";
+    case EventStatus::OnScene:
+      return "On Scene";
+    case EventStatus::Pending:
+      return "Pending";
+    case EventStatus::Waiting:
+      return "Waiting";
+    case EventStatus::Cleared:
+      return "Cleared";
+    case EventStatus::Archived:
+      return "Archived";
+    default:
+      return "";
+  }
+}
+
+// Match a source status string case-insensitively, ignoring spaces
+EventStatus toStatus(std::string_view statusStr) {
+  std::string status;
+  for(char c : statusStr)
+    if(!std::isspace(static_cast<unsigned char>(c)))
+      status += std::toupper(static_cast<unsigned char>(c));
+
+  if(status == "ACTIVE" || status == "OPEN")
+    return EventStatus::Active;
+  if(status == "DISPATCHED")
+    return EventStatus::Dispatched;
+  if(status == "ENROUTE")
+    return EventStatus::EnRoute;
+  if(status == "ONSCENE")
+    return EventStatus::OnScene;
+  if(status == "PENDING")
+    return EventStatus::Pending;
+  if(status == "WAITING")
+    return EventStatus::Waiting;
+  if(status == "CLEARED" || status == "CLOSED")
+    return EventStatus::Cleared;
+  if(status == "ARCHIVED")
+    return EventStatus::Archived;
+
+  return EventStatus::OTHER;
+}
+
+// Convert a direction to its display string
+std::string_view toString(const Direction& direction) {
+  switch(direction) {
+    case Direction::Northbound:
+      return "NB";
+    case Direction::Southbound:
+      return "SB";
+    case Direction::Eastbound:
+      return "EB";
+    case Direction::Westbound:
+      return "WB";
+    case Direction::Both:
+      return "Both";
+    case Direction::Inbound:
+      return "Inbound";
+    case Direction::Outbound:
+      return "Outbound";
+    case Direction::InnerLoop:
+      return "Inner Loop";
+    case Direction::OuterLoop:
+      return "Outer Loop";
+    default:
+      return "N/A";
+  }
+}
+
+// Match the direction formats used by each source ("NB", "North", "Northbound", "Both Directions", ...)
+Direction toDirection(std::string_view directionStr) {
+  std::string direction;
+  for(char c : directionStr)
+    direction += std::toupper(static_cast<unsigned char>(c));
+  trim(direction);
+
+  if(direction.empty() || direction == "N/A" || direction == "UNKNOWN" || direction == "NONE")
+    return Direction::UNKNOWN;
+  if(direction == "NB" || direction == "N" || direction == "NORTH" || direction == "NORTHBOUND")
+    return Direction::Northbound;
+  if(direction == "SB" || direction == "S" || direction == "SOUTH" || direction == "SOUTHBOUND")
+    return Direction::Southbound;
+  if(direction == "EB" || direction == "E" || direction == "EAST" || direction == "EASTBOUND")
+    return Direction::Eastbound;
+  if(direction == "WB" || direction == "W" || direction == "WEST" || direction == "WESTBOUND")
+    return Direction::Westbound;
+  if(direction == "BOTH" || direction == "BOTH DIRECTIONS" || direction == "ALL DIRECTIONS")
+    return Direction::Both;
+  if(direction == "INBOUND")
+    return Direction::Inbound;
+  if(direction == "OUTBOUND")
+    return Direction::Outbound;
+  if(direction == "INNER LOOP")
+    return Direction::InnerLoop;
+  if(direction == "OUTER LOOP")
+    return Direction::OuterLoop;
+
+  return Direction::OTHER;
+}
+
 // Set the current source and session cookie
 void setSource(const DataSource source) {
   currentSource = source;
@@ -169,43 +288,40 @@ void fetchEvents() {
 
 void fetchCameras() {
   Output::logger.log(Output::LogLevel::INFO, "CAMERAS", "Fetching NYS 511 cameras");
-  getCameras(NYSDOT::CAMERAS_URL);
+  // Events only need relinking when the camera list was replaced
+  if(getCameras(NYSDOT::CAMERAS_URL))
+    linkCameras(mapEvents);
 }
 
 // Print all events in the map
 void printEvents() {
   // Lock the map for reading
-  std::lock_guard<std::mutex> lock(eventsMutex);
-  for(auto& [key, event] : mapEvents) {
-    event.print();
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+  for(Event* event : mapEvents.select(std::nullopt, std::nullopt)) {
+    event->print();
   }
   std::cout << "\nFound " << mapEvents.size() << " matching events.\n";
 }
 
 void printEvents(Region region) {
-  int count{0};
   // Lock the map for reading
-  std::lock_guard<std::mutex> lock(eventsMutex);
-  for(auto& [key, event] : mapEvents) {
-    if(event.getRegion() == region) {
-      event.print();
-      count++;
-    }
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+  // Visit only the events in the region index
+  auto events = mapEvents.select(region, std::nullopt);
+  for(Event* event : events) {
+    event->print();
   }
-  std::cout << "\nFound " << count << " matching events.\n";
+  std::cout << "\nFound " << events.size() << " matching events.\n";
 }
 
 // Retrieve all events from the URL
 bool getEvents(std::string url) {
   // Check for Data Source
   if(url.find("511ny.org") != std::string::npos) {
-    // Source API key
+    // Source API key, read from the environment by main before any thread starts
     if(NYSDOT::API_KEY.empty()) {
-      NYSDOT::getEnv();
-      if(NYSDOT::API_KEY.empty()) {
-        Output::logger.log(Output::LogLevel::ERROR, "ENV", "Failed to retrieve NYSDOT API Key from local environment");
-        return false;
-      }
+      Output::logger.log(Output::LogLevel::ERROR, "ENV", "Failed to retrieve NYSDOT API Key from local environment");
+      return false;
     }
     url += NYSDOT::API_KEY;
     // Set current Data Source
@@ -227,11 +343,23 @@ bool getEvents(std::string url) {
     return false;
   }
 
+  // Intermediate parse data for this source lives in one arena, released when we return
+  // NOTE: Events committed to the store copy their data out of the arena
+  Arena::Cycle arena(arenaSizes[static_cast<std::size_t>(currentSource)]);
+
   // Initialize a new cURL handle for the current source
   cURL::Handle curlHandle;
 
   // Retrieve data with cURL
+  std::size_t source = static_cast<std::size_t>(currentSource);
+  auto fetchStart = std::chrono::steady_clock::now();
   auto [result, data, headers] = cURL::getData(url, curlHandle);
+  Metrics::fetchSeconds.observe(source, std::chrono::steady_clock::now() - fetchStart);
+  long httpStatus{ 0 };   // Left at 0 when no response arrived
+  if(result == cURL::Result::SUCCESS)
+    curl_easy_getinfo(curlHandle.get(), CURLINFO_RESPONSE_CODE, &httpStatus);
+  Metrics::fetchResponses.add(source * Metrics::FETCH_STATUS_COUNT + static_cast<std::size_t>(Metrics::toFetchStatus(httpStatus)));
+  Metrics::fetchBytes.add(source, data.size());
 
   // Check for successful extraction
   if(result == cURL::Result::SUCCESS) {
@@ -268,7 +396,8 @@ bool getEvents(std::string url) {
 
 
 // Process retrieved data string and headers
-bool processData(std::string& data, const std::vector<std::string>& headers) {
+bool processData(std::string& data, const cURL::Headers& headers) {
+  Metrics::Timer parseTimer(Metrics::parseSeconds, static_cast<std::size_t>(currentSource));
   // Extract the "Content-Type" header
   std::string contentType = cURL::getContentType(headers);
   
@@ -340,7 +469,7 @@ bool parseEvents(std::unique_ptr<rapidxml::xml_document<>> parsedData) {
   // Iterate throgh each event in the document tree
   for(rapidxml::xml_node<>* event = channel->first_node("item"); event; event = event->next_sibling()) {
     // Lock the map before processing the event
-    std::lock_guard<std::mutex> lock(eventsMutex);
+    std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
     if(currentSource == DataSource::MCNY)
       MCNY::processEvent(event); 
     else if(currentSource == DataSource::MTL)
@@ -350,15 +479,16 @@ bool parseEvents(std::unique_ptr<rapidxml::xml_document<>> parsedData) {
 }
 
 // Parse events from an array of temp HTML events
-bool parseEvents(const std::vector<HTML::Event>& parsedData) {
+bool parseEvents(const HTML::EventList& parsedData) {
   // Iterate through each parsed event in the vector
   for(const auto& parsedEvent : parsedData) {
-    processedKeys.push_back(parsedEvent.ID);
+    std::string key{ parsedEvent.ID };
+    processedKeys.insert({ currentSource, key });
     // Lock the map here
-    std::lock_guard<std::mutex> lock(eventsMutex);
+    std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
     // Try to insert it on the vector
     // Will not add if it already exists
-    mapEvents.try_emplace(parsedEvent.ID, parsedEvent);
+    mapEvents.tryEmplace(currentSource, key, parsedEvent);
   }
   // Clean up cleared events while our data is still in scope
   //clearEvents(parsedData);
@@ -390,22 +520,22 @@ bool processEvent(const Json::Value& parsedEvent) {
   }
   
   // Mark the key as processed
-  processedKeys.push_back(key);
+  processedKeys.insert({ currentSource, key });
 
   // Lock the map before inserting
-  std::lock_guard<std::mutex> lock(eventsMutex);
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
 
   // Add the event
   // Try to insert a new Event at event, inserted = false if it already exists
-  auto [event, inserted] = mapEvents.try_emplace(key, parsedEvent);
+  auto [event, inserted] = mapEvents.tryEmplace(currentSource, key, parsedEvent);
   // Check if we added a new event
   if(!inserted) {
     // Check for updated timestamp
-    if(event->second.getLastUpdated() == getTime(parsedEvent)) {
+    if(event->getUpdatedTime() == Time::toEpoch(getTime(parsedEvent))) {
       return false;
     }
     // Update the event
-    event->second = parsedEvent;
+    mapEvents.update(currentSource, key, Event(parsedEvent));
     std::string msg = "Updated event: " + key;
     Output::logger.log(Output::LogLevel::INFO, "JSON", msg);
   }
@@ -469,27 +599,30 @@ std::chrono::system_clock::time_point getTime(const Json::Value& parsedEvent){
 // Clear all events from the map which we didn't process this loop
 void clearEvents() {
   std::vector<std::string> keysToDelete;
+  EventKey probe;
   // Lock the map for processing
-  std::lock_guard<std::mutex> lock(eventsMutex);
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
   // Iterate through ONLY markets we extracted this run
   for(const auto& source : extractedSources) {
-    // Iterate through the events map
-    for(const auto& [key, event] : mapEvents) {
-      // Check the region
-      if(event.getSource() == source) {
-        // Search for the current key in the vector of processed keys
-        auto it = std::find(processedKeys.begin(), processedKeys.end(), key);
-        if(it == processedKeys.end()) { // If we did not find the key on the vector
-          // Mark the key for deletion
-          keysToDelete.push_back(key);
-          std::string msg = "Marked event fo deletion: " + key;
-          Output::logger.log(Output::LogLevel::INFO, "EVENTS", msg);
-        }
+    keysToDelete.clear();
+    probe.source = source;
+    // Iterate through the events indexed under the source
+    for(const Event* event : std::as_const(mapEvents).select(std::nullopt, source)) {
+      // Event IDs match their map keys, reuse the probe's buffer for the lookup
+      probe.id.assign(event->getID());
+      if(!processedKeys.contains(probe)) { // If this source did not process the key
+        // Mark the key for deletion
+        std::string msg = "Marked event fo deletion: " + probe.id;
+        Output::logger.log(Output::LogLevel::INFO, "EVENTS", msg);
+        keysToDelete.push_back(probe.id);
       }
     }
+    // Keys are only unique within a source
+    deleteEvents(source, keysToDelete);
   }
 
-  deleteEvents(keysToDelete);
+  // Release interned strings that only deleted or replaced events referenced
+  Intern::purge();
   processedKeys.clear();
   keysToDelete.clear();
   extractedSources.clear();
@@ -498,28 +631,98 @@ void clearEvents() {
 
 // Delete all events that match given keys from the map
 // NOTE: Locking already implemented within clearEvents, our map is already locked at this point
-void deleteEvents(const std::vector<std::string>& keys) {
+void deleteEvents(DataSource source, const std::vector<std::string>& keys) {
   for(const auto& key : keys) {
-    mapEvents.erase(key);
+    mapEvents.erase(source, key);  // Also drops the event from the secondary indexes
     std::string msg = "Deleted event: " + key;
     Output::logger.log(Output::LogLevel::INFO, "EVENTS", msg);
   }
 }
 
-// Serialize all traffic events into Json objects
-std::optional<Json::Value> serializeEventsToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams) {
-  // Create an array to hold all events
-  Json::Value eventsArray(Json::arrayValue);
+namespace {
+
+// Orders events can be returned in
+enum class EventOrder : std::uint8_t {
+  Store,                // As the indexes produce them, only used without paging
+  Key,                  // By source, then ID
+  UpdatedAscending,     // Oldest update first, ties by key
+  UpdatedDescending     // Newest update first, ties by key
+};
+
+// Position of an event in an ordering, and what a cursor records
+struct PageKey {
+  std::int64_t updated;
+  DataSource source;
+  std::string_view id;
+};
+
+PageKey pageKey(const Event& event) {
+  return { event.getUpdatedTime(), event.getSource(), event.getID() };
+}
+
+// Every ordering ends with the unique key, so pages are stable across requests
+bool precedes(EventOrder order, const PageKey& a, const PageKey& b) {
+  if(a.updated != b.updated) {
+    if(order == EventOrder::UpdatedAscending)
+      return a.updated < b.updated;
+    if(order == EventOrder::UpdatedDescending)
+      return a.updated > b.updated;
+  }
+  if(a.source != b.source)
+    return a.source < b.source;
+  return a.id < b.id;
+}
+
+// Cursors are "<updated>,<source>,<id>" of the last event on a page
+std::string makeCursor(const Event& event) {
+  return std::to_string(event.getUpdatedTime()) + ',' + toString(event.getSource()) + ',' + std::string(event.getID());
+}
+
+// The returned key views into the cursor string
+std::optional<PageKey> parseCursor(const std::string& cursor) {
+  auto first = cursor.find(',');
+  auto second = first == std::string::npos ? std::string::npos : cursor.find(',', first + 1);
+  if(second == std::string::npos)
+    return std::nullopt;
+  auto updated = RestAPI::parseUnsigned(cursor.substr(0, first));
+  DataSource source = toSource(cursor.substr(first + 1, second - first - 1));
+  if(!updated || *updated > static_cast<std::uint64_t>(INT64_MAX) || source == DataSource::UNKNOWN)
+    return std::nullopt;
+  return PageKey{ static_cast<std::int64_t>(*updated), source, std::string_view(cursor).substr(second + 1) };
+}
+
+} // namespace
+
+// Serialize all traffic events into an array
+// Full JSON events are copied from their cached fragments, so unchanged events are never re-serialized.
+// MessagePack events are written straight from the store, the response cache keeps the result.
+// Projected events write only the requested fields. Paging reads the sort key of each match once before ordering,
+// and only the events on the page are ever serialized
+std::optional<std::string> serializeEvents(const std::vector<std::pair<std::string, std::string>>& queryParams, EventFormat format) {
   // Create optional filter values
   std::optional<Region> filterRegion{std::nullopt};
   std::optional<DataSource> filterSource{std::nullopt};
+  std::optional<Location> filterCenter{std::nullopt};
+  double filterRadius{ 0.0 };
+
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : queryParams) {
+    if(key != "region" && key != "source" && key != "bbox" && key != "lat" && key != "lon" && key != "radius"
+       && key != "limit" && key != "cursor" && key != "fields" && key != "sort")
+      return std::nullopt;
+  }
 
   // Extract filter parameters
   auto regionParam = RestAPI::findQueryParam(queryParams, "region");
   auto sourceParam = RestAPI::findQueryParam(queryParams, "source");
-  // Error out if we have invalid keys
-  if(!(regionParam || sourceParam || queryParams.empty()))
-    return std::nullopt;
+  auto boxParam = RestAPI::findQueryParam(queryParams, "bbox");
+  auto latParam = RestAPI::findQueryParam(queryParams, "lat");
+  auto lonParam = RestAPI::findQueryParam(queryParams, "lon");
+  auto radiusParam = RestAPI::findQueryParam(queryParams, "radius");
+  auto limitParam = RestAPI::findQueryParam(queryParams, "limit");
+  auto cursorParam = RestAPI::findQueryParam(queryParams, "cursor");
+  auto fieldsParam = RestAPI::findQueryParam(queryParams, "fields");
+  auto sortParam = RestAPI::findQueryParam(queryParams, "sort");
   if(regionParam) {
     // Set the filter value
     filterRegion = toRegion(*regionParam);
@@ -528,162 +731,490 @@ std::optional<Json::Value> serializeEventsToJSON(const std::vector<std::pair<std
     // Set the filter value
     filterSource = toSource(*sourceParam);
   }
+  // Set the bounding box "west,south,east,north"
+  // NOTE: BoundingBox is not assignable, so construct the optional in place
+  const std::optional<BoundingBox> filterBox = boxParam ? RestAPI::parseBoundingBox(*boxParam) : std::nullopt;
+  if(boxParam && !filterBox)
+    return std::nullopt;
+  if(latParam || lonParam || radiusParam) {
+    // A radius query needs all three values and can't be combined with a box
+    if(!(latParam && lonParam && radiusParam) || filterBox)
+      return std::nullopt;
+    auto lat = RestAPI::parseNumber(*latParam);
+    auto lon = RestAPI::parseNumber(*lonParam);
+    auto radius = RestAPI::parseNumber(*radiusParam);
+    if(!lat || !lon || !radius || *radius <= 0.0 || *radius > EVENTS_RADIUS_LIMIT_KM || std::abs(*lat) > 90.0 || std::abs(*lon) > 180.0)
+      return std::nullopt;
+    filterCenter = Location(*lat, *lon);
+    filterRadius = *radius;
+  }
 
+  // Page size, ordering and projection
+  std::optional<std::size_t> limit;
+  if(limitParam) {
+    auto parsed = RestAPI::parseUnsigned(*limitParam);
+    if(!parsed || *parsed == 0 || *parsed > EVENTS_PAGE_LIMIT)
+      return std::nullopt;
+    limit = static_cast<std::size_t>(*parsed);
+  }
+  std::optional<PageKey> cursor;
+  if(cursorParam) {
+    cursor = parseCursor(*cursorParam);
+    if(!cursor)
+      return std::nullopt;
+  }
+  bool paged = limit || cursor;
+  EventOrder order = paged ? EventOrder::Key : EventOrder::Store;
+  if(sortParam) {
+    if(*sortParam == "updated")
+      order = EventOrder::UpdatedAscending;
+    else if(*sortParam == "-updated")
+      order = EventOrder::UpdatedDescending;
+    else
+      return std::nullopt;
+  }
+  EventFieldMask fields{ ALL_EVENT_FIELDS };
+  if(fieldsParam) {
+    auto parsed = parseEventFields(*fieldsParam);
+    if(!parsed)
+      return std::nullopt;
+    fields = *parsed;
+  }
   
   // Serialize the data
   // Lock the map to this thread for reading
-  std::lock_guard<std::mutex> lock(eventsMutex);    // Must be locked before entering the loop to prevent iterator invalidation
-  // And read the map
-  for(const auto& [key, event] : mapEvents) {
-    // Check if we have a region filter
-    if((filterRegion && event.getRegion() != *filterRegion) || (filterSource && event.getSource() != *filterSource))
-      continue;
-    
-    // Else we either aren't filtering, or filter matches, so we want to add
-    // Create a json item from the event
-    Json::Value item;
-    event.serializeToJSON(item);
-
-    // Add the item to the root object
-    eventsArray.append(item);
-  }
-
-  return eventsArray;
-}
-
-
-void Event::serializeToJSON(Json::Value& item) const {
-  // Store fields in JSON
-  // String fields
-  item["id"] = ID;
-
-  if(URL == "N/A")
-    item["url"] = Json::nullValue;
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);    // Must be locked before entering the loop to prevent iterator invalidation
+  // Read only the matching events from the store's indexes
+  const EventStore& store = mapEvents;
+  std::vector<const Event*> matches;
+  if(filterBox)
+    matches = store.selectWithin(*filterBox, filterRegion, filterSource);
+  else if(filterCenter)
+    matches = store.selectNear(*filterCenter, filterRadius, filterRegion, filterSource);
   else
-    item["url"] = URL;
-
-  if(title == "N/A")
-    item["title"] = Json::nullValue;
-  else
-    item["title"] = title;
+    matches = store.select(filterRegion, filterSource);
+  // Features need a geometry, drop the 0,0 placeholder before paging so pages stay full
+  if(format == EventFormat::GeoJSON)
+    std::erase_if(matches, [](const Event* event){ return !event->hasLocation(); });
+
+  // Order only what is needed, a page of n events costs a selection plus a sort of n
+  bool more{ false };
+  if(order != EventOrder::Store) {
+    // Read each event's key once, the selection and sort then compare within this array
+    std::vector<std::pair<PageKey, const Event*>> keyed;
+    keyed.reserve(matches.size());
+    for(const Event* event : matches) {
+      PageKey key = pageKey(*event);
+      if(!cursor || precedes(order, *cursor, key))
+        keyed.emplace_back(key, event);
+    }
+    auto before = [order](const auto& a, const auto& b){ return precedes(order, a.first, b.first); };
+    if(limit && keyed.size() > *limit) {
+      auto pageEnd = keyed.begin() + static_cast<std::ptrdiff_t>(*limit);
+      std::nth_element(keyed.begin(), pageEnd, keyed.end(), before);
+      keyed.erase(pageEnd, keyed.end());
+      more = true;
+    }
+    std::sort(keyed.begin(), keyed.end(), before);
+    matches.clear();
+    for(const auto& [key, event] : keyed)
+      matches.push_back(event);
+  }
 
-  item["status"] = status;
+  if(format == EventFormat::MessagePack) {
+    MsgPack::Writer writer;
+    if(paged)
+      writer.map(2).key("events");
+    writer.array(matches.size());
+    for(const Event* event : matches)
+      event->serializeToMsgPack(writer, fields);
+    if(paged) {
+      writer.key("next");
+      if(more)
+        writer.value(makeCursor(*matches.back()));
+      else
+        writer.null();
+    }
+    return writer.release();
+  }
 
-  if(mainStreet == "N/A")
-    item["main"] = Json::nullValue;
-  else
-    item["main"] = mainStreet;
+  JSON::Writer writer;
+  if(fields == ALL_EVENT_FIELDS) {
+    std::size_t length{ 64 };   // Brackets and the paging wrapper
+    std::size_t perEvent = format == EventFormat::GeoJSON ? 128 : 1;   // Feature wrapper and geometry
+    for(const Event* event : matches)
+      length += event->getJSONFragment().size() + perEvent;
+    writer.reserve(length);
+  }
+  if(format == EventFormat::GeoJSON) {
+    writer.beginObject();
+    writer.key("type").value("FeatureCollection");
+    writer.key("features").beginArray();
+    for(const Event* event : matches) {
+      writer.beginObject();
+      writer.key("type").value("Feature");
+      writer.key("id").value(std::string(sourceName(event->getSource())) + ':' + std::string(event->getID()));
+      // GeoJSON positions are longitude first
+      writer.key("geometry").beginObject();
+      writer.key("type").value("Point");
+      writer.key("coordinates").beginArray().value(event->getLocation().longitude).value(event->getLocation().latitude).endArray();
+      writer.endObject();
+      writer.key("properties");
+      if(fields == ALL_EVENT_FIELDS)
+        writer.raw(event->getJSONFragment());
+      else
+        event->serializeToJSON(writer, fields);
+      writer.endObject();
+    }
+    writer.endArray();
+    if(paged) {
+      writer.key("next");
+      if(more)
+        writer.value(makeCursor(*matches.back()));
+      else
+        writer.null();
+    }
+    writer.endObject();
+    return writer.release();
+  }
+  if(paged)
+    writer.beginObject().key("events");
+  writer.beginArray();
+  for(const Event* event : matches) {
+    // Add the event to the array
+    if(fields == ALL_EVENT_FIELDS)
+      writer.raw(event->getJSONFragment());
+    else
+      event->serializeToJSON(writer, fields);
+  }
+  writer.endArray();
+  if(paged) {
+    writer.key("next");
+    if(more)
+      writer.value(makeCursor(*matches.back()));
+    else
+      writer.null();
+    writer.endObject();
+  }
 
-  if(crossStreet == "N/A")
-    item["secondary"] = Json::nullValue;
-  else
-    item["secondary"] = crossStreet;
+  return writer.release();
+}
 
-  if(direction == "N/A")
-    item["direction"] = Json::nullValue;
-  else
-    item["direction"] = direction;
+// Serialize the events changed since a sequence number
+// Inserted and updated events carry their current state, deleted events only their key
+std::optional<std::string> serializeChangesToJSON(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  // Error out if we have invalid keys
+  for(const auto& [key, value] : queryParams) {
+    if(key != "since")
+      return std::nullopt;
+  }
+  auto sinceParam = RestAPI::findQueryParam(queryParams, "since");
+  if(!sinceParam)
+    return std::nullopt;
+  auto since = RestAPI::parseUnsigned(*sinceParam);
+  if(!since)
+    return std::nullopt;
 
-  if(description == "N/A")
-    item["description"] = Json::nullValue;
-  else
-    item["description"] = description;
+  // Lock the map to this thread for reading
+  std::lock_guard<Metrics::TimedMutex> lock(eventsMutex);
+  const EventStore& store = mapEvents;
+  ChangeSet changeSet = store.changesSince(*since);
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.key("sequence").value(changeSet.sequence);
+  writer.key("reset").value(changeSet.reset);
+  writer.key("changes").beginArray();
+  for(const Change* change : changeSet.changes) {
+    writer.beginObject();
+    writer.key("seq").value(change->sequence);
+    writer.key("type").value(toString(change->type));
+    writer.key("id").value(change->id);
+    writer.key("source").nullable(sourceName(change->source));
+    if(change->type != ChangeType::Delete) {
+      // Inserted and updated events reuse their cached JSON
+      if(const Event* event = store.find(change->source, change->id))
+        writer.key("event").raw(event->getJSONFragment());
+    }
+    writer.endObject();
+  }
+  writer.endArray();
+  writer.endObject();
+  return writer.release();
+}
 
+// Source and region names used by the API
+std::string_view sourceName(DataSource dataSource) {
   switch(dataSource) {
     case DataSource::NYSDOT:
-      item["source"] = "NYSDOT";
-      break;
+      return "NYSDOT";
     case DataSource::ONGOV:
-      item["source"] = "ONGOV";
-      break;
+      return "ONGOV";
     case DataSource::MCNY:
-      item["source"] = "MCNY";
-      break;
+      return "MCNY";
     case DataSource::ONMT:
-      item["source"] = "ONMT";
-      break;
+      return "ONMT";
     case DataSource::OTT:
-      item["source"] = "OTT";
-      break;
+      return "OTT";
     case DataSource::MTL:
-      item["source"] = "MTL";
-      break;
+      return "MTL";
     default:
-      item["source"] = Json::nullValue;
-      break;
+      return "";
   }
+}
 
+std::string_view regionName(Region region) {
   switch(region) {
     case Region::Syracuse:
-      item["region"] = "Syracuse";
-      break;
+      return "Syracuse";
     case Region::Rochester:
-      item["region"] = "Rochester";
-      break;
+      return "Rochester";
     case Region::Buffalo:
-      item["region"] = "Buffalo";
-      break;
+      return "Buffalo";
     case Region::Albany:
-      item["region"] = "Albany";
-      break;
+      return "Albany";
     case Region::Binghamton:
-      item["region"] = "Binghamton";
-      break;
+      return "Binghamton";
     case Region::Toronto:
-      item["region"] = "Toronto";
-      break;
+      return "Toronto";
     case Region::Ottawa:
-      item["region"] = "Ottawa";
-      break;
+      return "Ottawa";
     case Region::Montreal:
-      item["region"] = "Montreal";
-      break;
+      return "Montreal";
     default:
-      item["region"] = Json::nullValue;
-      break;
+      return "";
   }
-  
-  // Create a Json object to hold the latitude and longitude
-  Json::Value coordinates;
-  if(getCoordinates() == std::make_pair(0.0, 0.0)) {
-    coordinates["lat"] = Json::nullValue;
-    coordinates["long"] = Json::nullValue;
-  } else {
-    coordinates["lat"] = getLocation().latitude;
-    coordinates["long"] = getLocation().longitude;
+}
+
+namespace {
+
+// Placeholder text is written as null
+std::string_view knownOrEmpty(std::string_view text) {
+  return text == "N/A" ? std::string_view() : text;
+}
+
+// Bit positions in EventFieldMask
+enum EventField : std::size_t {
+  FIELD_ID,
+  FIELD_URL,
+  FIELD_TITLE,
+  FIELD_STATUS,
+  FIELD_MAIN,
+  FIELD_SECONDARY,
+  FIELD_DIRECTION,
+  FIELD_DESCRIPTION,
+  FIELD_SOURCE,
+  FIELD_REGION,
+  FIELD_COORDINATES,
+  FIELD_REPORTED,
+  FIELD_UPDATED,
+  FIELD_CAMERAS,
+  FIELD_COUNT
+};
+
+// Field names as written in the JSON, indexed by EventField
+constexpr std::array<std::string_view, FIELD_COUNT> EVENT_FIELD_NAMES{
+  "id", "url", "title", "status", "main", "secondary", "direction", "description",
+  "source", "region", "coordinates", "reported", "updated", "cameras"
+};
+
+} // namespace
+
+std::optional<EventFieldMask> parseEventFields(const std::string& fieldList) {
+  EventFieldMask fields{ 0 };
+  std::stringstream ss(fieldList);
+  std::string name;
+  // Elements delimited by ','
+  while(std::getline(ss, name, ',')) {
+    trim(name);
+    auto found = std::find(EVENT_FIELD_NAMES.begin(), EVENT_FIELD_NAMES.end(), name);
+    if(found == EVENT_FIELD_NAMES.end())
+      return std::nullopt;
+    fields |= static_cast<EventFieldMask>(1 << (found - EVENT_FIELD_NAMES.begin()));
   }
-  item["coordinates"] = coordinates;
+  if(fields == 0)
+    return std::nullopt;
+  return fields;
+}
 
-  if(timeReported != std::chrono::system_clock::time_point{}) 
-    item["reported"] = Time::ISO6801::toString(timeReported);
-  else
-    item["reported"] = Json::nullValue;
+// Fields left out of the mask are skipped entirely, none of their text is formatted
+void Event::serializeToJSON(JSON::Writer& writer, EventFieldMask fields) const {
+  auto wanted = [fields](EventField field){ return (fields & (1 << field)) != 0; };
+  writer.beginObject();
+  // String fields
+  if(wanted(FIELD_ID))
+    writer.key("id").value(ID);
+  if(wanted(FIELD_URL))
+    writer.key("url").nullable(knownOrEmpty(URL.view()));
+  if(wanted(FIELD_TITLE))
+    writer.key("title").nullable(knownOrEmpty(title.view()));
+  if(wanted(FIELD_STATUS))
+    writer.key("status").value(getStatusText());
+  if(wanted(FIELD_MAIN))
+    writer.key("main").nullable(knownOrEmpty(mainStreet.view()));
+  if(wanted(FIELD_SECONDARY))
+    writer.key("secondary").nullable(knownOrEmpty(crossStreet.view()));
+  if(wanted(FIELD_DIRECTION)) {
+    writer.key("direction");
+    if(summary.direction == Direction::UNKNOWN)
+      writer.null();
+    else
+      writer.value(getDirectionText());
+  }
+  if(wanted(FIELD_DESCRIPTION))
+    writer.key("description").nullable(knownOrEmpty(description));
+  if(wanted(FIELD_SOURCE))
+    writer.key("source").nullable(sourceName(summary.dataSource));
+  if(wanted(FIELD_REGION))
+    writer.key("region").nullable(regionName(summary.region));
+
+  // Latitude and longitude
+  if(wanted(FIELD_COORDINATES)) {
+    writer.key("coordinates").beginObject();
+    if(hasLocation()) {
+      writer.key("lat").value(location.latitude);
+      writer.key("long").value(location.longitude);
+    } else {
+      writer.key("lat").null();
+      writer.key("long").null();
+    }
+    writer.endObject();
+  }
 
-  if(timeUpdated != std::chrono::system_clock::time_point{}) 
-    item["updated"] = Time::ISO6801::toString(timeUpdated);
-  else
-    item["updated"] = Json::nullValue;
+  if(wanted(FIELD_REPORTED)) {
+    writer.key("reported");
+    if(summary.timeReported != 0)
+      writer.value(Time::ISO6801::toString(Time::fromEpoch(summary.timeReported)));
+    else
+      writer.null();
+  }
+
+  if(wanted(FIELD_UPDATED)) {
+    writer.key("updated");
+    if(summary.timeUpdated != 0)
+      writer.value(Time::ISO6801::toString(Time::fromEpoch(summary.timeUpdated)));
+    else
+      writer.null();
+  }
+
+  // Only present when cameras have been linked to the event
+  if(wanted(FIELD_CAMERAS) && !nearbyCameras.empty()) {
+    writer.key("cameras").beginArray();
+    for(const NearbyCamera& camera : nearbyCameras) {
+      writer.beginObject();
+      writer.key("id").value(camera.id.view());
+      writer.key("distance").value(std::round(camera.distanceKm * 1000.0) / 1000.0);   // Kilometres
+      writer.endObject();
+    }
+    writer.endArray();
+  }
+  writer.endObject();
+}
+
+// Same fields and order as the JSON, with numbers kept binary instead of formatted as text
+void Event::serializeToMsgPack(MsgPack::Writer& writer, EventFieldMask fields) const {
+  auto wanted = [fields](EventField field){ return (fields & (1 << field)) != 0; };
+  // Entry count comes first, cameras are left out when none are linked
+  std::size_t entries{ 0 };
+  for(std::size_t field = 0; field < FIELD_COUNT; field++)
+    entries += wanted(static_cast<EventField>(field)) ? 1 : 0;
+  if(wanted(FIELD_CAMERAS) && nearbyCameras.empty())
+    entries--;
+  writer.map(entries);
+  // String fields
+  if(wanted(FIELD_ID))
+    writer.key("id").value(ID);
+  if(wanted(FIELD_URL))
+    writer.key("url").nullable(knownOrEmpty(URL.view()));
+  if(wanted(FIELD_TITLE))
+    writer.key("title").nullable(knownOrEmpty(title.view()));
+  if(wanted(FIELD_STATUS))
+    writer.key("status").value(getStatusText());
+  if(wanted(FIELD_MAIN))
+    writer.key("main").nullable(knownOrEmpty(mainStreet.view()));
+  if(wanted(FIELD_SECONDARY))
+    writer.key("secondary").nullable(knownOrEmpty(crossStreet.view()));
+  if(wanted(FIELD_DIRECTION)) {
+    writer.key("direction");
+    if(summary.direction == Direction::UNKNOWN)
+      writer.null();
+    else
+      writer.value(getDirectionText());
+  }
+  if(wanted(FIELD_DESCRIPTION))
+    writer.key("description").nullable(knownOrEmpty(description));
+  if(wanted(FIELD_SOURCE))
+    writer.key("source").nullable(sourceName(summary.dataSource));
+  if(wanted(FIELD_REGION))
+    writer.key("region").nullable(regionName(summary.region));
+
+  // Fixed-point latitude and longitude
+  if(wanted(FIELD_COORDINATES)) {
+    writer.key("coordinates").map(2);
+    if(hasLocation()) {
+      writer.key("lat").value(static_cast<std::int64_t>(std::llround(location.latitude * COORDINATE_SCALE)));
+      writer.key("long").value(static_cast<std::int64_t>(std::llround(location.longitude * COORDINATE_SCALE)));
+    } else {
+      writer.key("lat").null();
+      writer.key("long").null();
+    }
+  }
+
+  // Seconds since the UNIX epoch
+  if(wanted(FIELD_REPORTED)) {
+    writer.key("reported");
+    if(summary.timeReported != 0)
+      writer.value(summary.timeReported);
+    else
+      writer.null();
+  }
+
+  if(wanted(FIELD_UPDATED)) {
+    writer.key("updated");
+    if(summary.timeUpdated != 0)
+      writer.value(summary.timeUpdated);
+    else
+      writer.null();
+  }
+
+  if(wanted(FIELD_CAMERAS) && !nearbyCameras.empty()) {
+    writer.key("cameras").array(nearbyCameras.size());
+    for(const NearbyCamera& camera : nearbyCameras) {
+      writer.map(2);
+      writer.key("id").value(camera.id.view());
+      writer.key("distance").value(static_cast<std::int64_t>(std::llround(camera.distanceKm * 1000.0)));   // Metres
+    }
+  }
+}
+
+const std::string& Event::getJSONFragment() const {
+  if(jsonFragment.empty()) {
+    JSON::Writer writer;
+    serializeToJSON(writer);
+    jsonFragment = writer.release();
+  }
+  return jsonFragment;
 }
 
 
 // Constructor objects
 // Construct an event from an JSON object
 Event::Event(const Json::Value& parsedEvent)
-: dataSource{ currentSource }
 {
+  summary.dataSource = currentSource;
   // Process an Ottawa event
-  if(dataSource == DataSource::OTT) {
+  if(summary.dataSource == DataSource::OTT) {
     URL = "https://traffic.ottawa.ca/en/traffic-map-data-lists-and-resources/incidents-construction-and-special-events";
-    region = Region::Ottawa;
+    summary.region = Region::Ottawa;
     if(parsedEvent.isMember("id"))
       ID = parsedEvent["id"].asString();
     if(parsedEvent.isMember("eventType")) {
       title = parsedEvent["eventType"].asString();
-      Output::ottLog.writeLine("eventType", title);
+      Output::ottLog.writeLine("eventType", title.str());
     }
     if(parsedEvent.isMember("status")) {
-      status = parsedEvent["status"].asString();
-      Output::ottLog.writeLine("status", status);
+      std::string parsedStatus = parsedEvent["status"].asString();
+      setStatus(parsedStatus);
+      Output::ottLog.writeLine("status", parsedStatus);
     }
     if(parsedEvent.isMember("message")) {
       description = parsedEvent["message"].asString();
@@ -705,9 +1236,9 @@ Event::Event(const Json::Value& parsedEvent)
     }
 
     if(parsedEvent.isMember("created"))
-      timeReported = Time::YYYYMMDDHHMMSS::toChrono(parsedEvent["created"].asString());
+      summary.timeReported = Time::toEpoch(Time::YYYYMMDDHHMMSS::toChrono(parsedEvent["created"].asString()));
     if(parsedEvent.isMember("updated"))
-      timeUpdated = Time::YYYYMMDDHHMMSS::toChrono(parsedEvent["updated"].asString());
+      summary.timeUpdated = Time::toEpoch(Time::YYYYMMDDHHMMSS::toChrono(parsedEvent["updated"].asString()));
 
 // NOTE:
 //  Confirm correct regex parsing of headline
@@ -717,10 +1248,10 @@ Event::Event(const Json::Value& parsedEvent)
       Output::ottLog.writeLine("headline", parsedEvent["headline"].asString());
       auto parsedHeadline = OTT::parseHeadline(parsedEvent["headline"].asString());
       if(parsedHeadline) {
-        auto [road, dir, cross] = *parsedHeadline;
+        const auto& [road, dir, cross] = *parsedHeadline;
         mainStreet = road;
         if(dir)
-          direction = *dir;
+          setDirection(*dir);
         if(cross)
           crossStreet = *cross;
       }
@@ -735,18 +1266,18 @@ Event::Event(const Json::Value& parsedEvent)
     if(parsedEvent.isMember("RoadwayName"))
       mainStreet = parsedEvent["RoadwayName"].asString();
     if(parsedEvent.isMember("DirectionOfTravel"))
-      direction = parsedEvent["DirectionOfTravel"].asString();
+      setDirection(parsedEvent["DirectionOfTravel"].asString());
     if(parsedEvent.isMember("Latitude") && parsedEvent.isMember("Latitude")) {
       location = { parsedEvent["Latitude"].asDouble(), parsedEvent["Longitude"].asDouble() }; 
     }
 
     // Construct members for current source
-    switch(dataSource) {
+    switch(summary.dataSource) {
       // Construct members for NYSDOT
       case DataSource::NYSDOT:
         URL = "https://511ny.org/";
-        region = NYSDOT::getRegion(parsedEvent["RegionName"].asString());
-        if(region == Region::UNKNOWN)
+        summary.region = NYSDOT::getRegion(parsedEvent["RegionName"].asString());
+        if(summary.region == Region::UNKNOWN)
           Output::logger.log(Output::LogLevel::WARN, "JSON", "Failed to parse dataSource member during construction");
         if(parsedEvent.isMember("PrimaryLocation"))
           crossStreet = parsedEvent["PrimaryLocation"].asString();
@@ -755,11 +1286,11 @@ Event::Event(const Json::Value& parsedEvent)
         if(parsedEvent.isMember("EventSubType")) {
           std::string subType = parsedEvent["EventSubType"].asString();
           if(!subType.empty())
-            title = subType + " (" + title + ")";
+            title = subType + " (" + title.str() + ")";
         }
         if(parsedEvent.isMember("Reported") && parsedEvent.isMember("LastUpdated")) {
-          timeReported = Time::DDMMYYYYHHMMSS::toChrono(parsedEvent["Reported"].asString());
-          timeUpdated = Time::DDMMYYYYHHMMSS::toChrono(parsedEvent["LastUpdated"].asString());
+          summary.timeReported = Time::toEpoch(Time::DDMMYYYYHHMMSS::toChrono(parsedEvent["Reported"].asString()));
+          summary.timeUpdated = Time::toEpoch(Time::DDMMYYYYHHMMSS::toChrono(parsedEvent["LastUpdated"].asString()));
         }
         break;
       // Construct members for ONMT
@@ -767,20 +1298,20 @@ Event::Event(const Json::Value& parsedEvent)
         URL = "https://511on.ca/";
         // Determine the region
         if(ONMT::regionToronto.contains(location))
-          region = Region::Toronto;
+          summary.region = Region::Toronto;
         if(ONMT::regionOttawa.contains(location))
-          region = Region::Ottawa;
+          summary.region = Region::Ottawa;
         if(parsedEvent.isMember("Reported") && parsedEvent.isMember("LastUpdated")) {
-          timeReported = Time::UNIX::toChrono(parsedEvent["Reported"].asDouble(), std::nullopt);
-          timeUpdated = Time::UNIX::toChrono(parsedEvent["LastUpdated"].asDouble(), std::nullopt);
+          summary.timeReported = Time::toEpoch(Time::UNIX::toChrono(parsedEvent["Reported"].asDouble(), std::nullopt));
+          summary.timeUpdated = Time::toEpoch(Time::UNIX::toChrono(parsedEvent["LastUpdated"].asDouble(), std::nullopt));
         }
         // Parse the description value into [Title, Main Street, Secondary Street]
         if(parsedEvent.isMember("Description")) {
           description = parsedEvent["Description"].asString();
           auto parsedDescription = ONMT::parseDescription(description);
           if(parsedDescription) {
-            auto [eventTitle, eventMain, eventCross] = *parsedDescription;
-            title = eventTitle + " (" + title + ")";
+            const auto& [eventTitle, eventMain, eventCross] = *parsedDescription;
+            title = std::string(eventTitle) + " (" + title.str() + ")";
             crossStreet = eventCross;
           }
         }
@@ -795,9 +1326,12 @@ Event::Event(const Json::Value& parsedEvent)
 
 // Construct an event from a Rochester XML object
 Event::Event(const rapidxml::xml_node<>* item, const std::pair<std::string, std::string> &parsedDescription)
-: ID{ parsedDescription.second }, dataSource{ DataSource::MCNY }, region{Region::Rochester}, 
-  status{ parsedDescription.first }, timeUpdated{ Time::currentTime() }
+: ID{ parsedDescription.second }
 {
+  summary.dataSource = DataSource::MCNY;
+  summary.region = Region::Rochester;
+  summary.timeUpdated = Time::toEpoch(Time::currentTime());
+  setStatus(parsedDescription.first);
   if(rapidxml::xml_node<> *url = item->first_node("guid")){
     URL = url->value();
   }
@@ -806,9 +1340,9 @@ Event::Event(const rapidxml::xml_node<>* item, const std::pair<std::string, std:
     // Use regex to extract Title, street, direction(optional), and cross(optional)
     auto parsedDescription = MCNY::processTitle(description);
     if(parsedDescription) {
-      auto [parsedTitle, parsedStreet, parsedDirection, parsedCross] = *parsedDescription;
+      const auto& [parsedTitle, parsedStreet, parsedDirection, parsedCross] = *parsedDescription;
       if(parsedDirection)
-        direction = *parsedDirection;
+        setDirection(*parsedDirection);
       if(parsedCross)
         crossStreet = *parsedCross;
       this->title = parsedTitle;        // Make sure to dereference the "this" member rather than our node*
@@ -818,7 +1352,7 @@ Event::Event(const rapidxml::xml_node<>* item, const std::pair<std::string, std:
   if(rapidxml::xml_node<> *pubDate = item->first_node("pubDate")){
     // Try to convert to a time object
     if(auto timeOpt = Time::RFC2822::toChrono(pubDate->value())){
-      timeReported = *timeOpt;
+      summary.timeReported = Time::toEpoch(*timeOpt);
     }
   }
   // Parse the location
@@ -833,8 +1367,12 @@ Event::Event(const rapidxml::xml_node<>* item, const std::pair<std::string, std:
 
 // Construct an event from a Montreal XML object
 Event::Event(const rapidxml::xml_node<>* parsedEvent) 
-: dataSource{ DataSource::MTL }, region{ Region::Montreal }, location{ Location(45.5019, -73.5674) }, timeUpdated{ Time::currentTime() }
+: location{ Location(45.5019, -73.5674) }
 {
+  summary.dataSource = DataSource::MTL;
+  summary.region = Region::Montreal;
+  summary.timeUpdated = Time::toEpoch(Time::currentTime());
+
   // Set the ID and URL
   std::string url;
   if(rapidxml::xml_node<>* link = parsedEvent->first_node("link")){
@@ -903,23 +1441,25 @@ Event::Event(const rapidxml::xml_node<>* parsedEvent)
   if(rapidxml::xml_node<>* pubDate = parsedEvent->first_node("pubDate")){
     auto timeOpt = Time::RFC2822::toChrono(pubDate->value());
     if(timeOpt)
-      timeReported = *timeOpt;
+      summary.timeReported = Time::toEpoch(*timeOpt);
   }
 
 }
 
 // Construct an event from an HTML event
 Event::Event(const HTML::Event& parsedEvent)
-: ID{ parsedEvent.ID }, URL{ "https://911events.ongov.net/CADInet/app/events.jsp" }, dataSource{ DataSource::ONGOV },
-  region{ Region::Syracuse }, location{ Location(43.0495, -76.1474) }, timeUpdated{ Time::currentTime() }
+: location{ Location(43.0495, -76.1474) }, ID{ parsedEvent.ID }, URL{ "https://911events.ongov.net/CADInet/app/events.jsp" }
 {
+  summary.dataSource = DataSource::ONGOV;
+  summary.region = Region::Syracuse;
+  summary.timeUpdated = Time::toEpoch(Time::currentTime());
   std::string descStr{ "" };    // Create a string to build and hold the description
 
   if(parsedEvent.title != "") {
     // Process the event title
     title = parsedEvent.title;
     // Add the title to the string followed by " at "
-    descStr += title + " at ";
+    descStr += title.str() + " at ";
   }
   if(parsedEvent.address != "") {
     // Process the main street
@@ -928,7 +1468,7 @@ Event::Event(const HTML::Event& parsedEvent)
     if(parsedEvent.xstreet1 != "")
       mainStreet = parsedEvent.xstreet1;
   }
-  descStr += mainStreet + ' ';
+  descStr += mainStreet.str() + ' ';
 
   if(parsedEvent.xstreet != "") {
     if(parsedEvent.address == "") {
@@ -939,17 +1479,17 @@ Event::Event(const HTML::Event& parsedEvent)
       crossStreet = parsedEvent.xstreet;
     }
     // Add the cross street to the string
-    descStr += "(X: " + crossStreet + ") ";
+    descStr += "(X: " + crossStreet.str() + ") ";
   }
   if(parsedEvent.direction != "") {
-    direction = parsedEvent.direction;
-    descStr += direction + ' ';
+    setDirection(parsedEvent.direction);
+    descStr += parsedEvent.direction + ' ';
   }
   if(parsedEvent.date != "") {
     // Prevent crashes! check for strlength
     if(parsedEvent.date.length() == 14) {
       // Process the event date
-      timeReported = Time::MMDDYYHHMM::toChrono(parsedEvent.date);
+      summary.timeReported = Time::toEpoch(Time::MMDDYYHHMM::toChrono(std::string(parsedEvent.date)));
     }
   }
   if(parsedEvent.details != "") {
@@ -958,21 +1498,36 @@ Event::Event(const HTML::Event& parsedEvent)
   description = std::move(descStr);
 }
 
+// Restore an event from previously saved fields
+Event::Event(const EventFields& fields)
+: summary(fields.summary),
+  location(fields.location),
+  ID(fields.id),
+  URL(fields.url),
+  title(fields.title),
+  statusText(fields.statusText),
+  directionText(fields.directionText),
+  mainStreet(fields.mainStreet),
+  crossStreet(fields.crossStreet),
+  description(fields.description)
+{
+
+}
+
 // Move constructor for an event object
 Event::Event(Event&& other) noexcept 
-: ID(std::move(other.ID)),
+: summary(other.summary),
+  location(other.location),
+  ID(std::move(other.ID)),
   URL(std::move(other.URL)),
-  dataSource(other.dataSource),
-  region(other.region),
   title(std::move(other.title)),
-  status(std::move(other.status)),
+  statusText(std::move(other.statusText)),
+  directionText(std::move(other.directionText)),
   mainStreet(std::move(other.mainStreet)),
   crossStreet(std::move(other.crossStreet)),
-  direction(std::move(other.direction)),
   description(std::move(other.description)),
-  location(other.location),
-  timeReported(std::move(other.timeReported)),
-  timeUpdated(std::move(other.timeUpdated))
+  nearbyCameras(std::move(other.nearbyCameras)),
+  jsonFragment(std::move(other.jsonFragment))
 {
 
 }
@@ -981,23 +1536,52 @@ Event::Event(Event&& other) noexcept
 Event& Event::operator=(Event&& other) noexcept {
   // Check for self-assignment
   if(this != &other) {
+    summary = other.summary;
+    location = other.location;
     ID = std::move(other.ID);
     URL = std::move(other.URL);
-    dataSource = other.dataSource;
-    region = other.region;
     title = std::move(other.title);
-    status = std::move(other.status);
+    statusText = std::move(other.statusText);
+    directionText = std::move(other.directionText);
     mainStreet = std::move(other.mainStreet);
     crossStreet = std::move(other.crossStreet);
-    direction = std::move(other.direction);
     description = std::move(other.description);
-    location = other.location;
-    timeReported = std::move(other.timeReported);
-    timeUpdated = std::move(other.timeUpdated);
+    nearbyCameras = std::move(other.nearbyCameras);
+    jsonFragment = std::move(other.jsonFragment);
   }
   return *this;
 }
 
+// Set the status enum, keeping the source text for unrecognized values
+void Event::setStatus(std::string_view statusStr) {
+  summary.status = toStatus(statusStr);
+  statusText = (summary.status == EventStatus::OTHER) ? Intern::String(statusStr) : Intern::String();
+}
+
+// Set the direction enum, keeping the source text for unrecognized values
+void Event::setDirection(std::string_view directionStr) {
+  summary.direction = toDirection(directionStr);
+  directionText = (summary.direction == Direction::OTHER) ? Intern::String(directionStr) : Intern::String();
+}
+
+// Get every stored field, the raw status and direction text are kept as is
+EventFields Event::getFields() const {
+  return { summary, location, ID, URL.view(), title.view(), statusText.view(), directionText.view(),
+           mainStreet.view(), crossStreet.view(), description };
+}
+
+std::string_view Event::getStatusText() const {
+  if(summary.status == EventStatus::OTHER)
+    return statusText.view();
+  return toString(summary.status);
+}
+
+std::string_view Event::getDirectionText() const {
+  if(summary.direction == Direction::OTHER)
+    return directionText.view();
+  return toString(summary.direction);
+}
+
 //
 void Event::print() {
   std::cout << *this;
@@ -1005,88 +1589,73 @@ void Event::print() {
 }
 
 
-// TODO:
 // Camera functions
-bool getCameras(std::string url){
-  // Source API key
-  if(NYSDOT::API_KEY.empty())
-    NYSDOT::getEnv();
-  assert(!NYSDOT::API_KEY.empty() && "Failed to retrieve API key from local environment.");
+// Stream the camera list and parse one camera at a time, the full response is never held in memory
+bool getCameras(std::string url) {
+  // Source API key, read from the environment by main before any thread starts
+  if(NYSDOT::API_KEY.empty()) {
+    Output::logger.log(Output::LogLevel::ERROR, "ENV", "Failed to retrieve NYSDOT API Key from local environment");
+    return false;
+  }
   url += NYSDOT::API_KEY;
-  // Set current Data Source
-  currentSource = DataSource::NYSDOT;
 
   // Create a curl handle for the request
   cURL::Handle curlHandle;
-  
-  // Retrieve data with cURL
-  auto [result, data, headers] = cURL::getData(url, curlHandle);
-  
-  // Check for successful extraction
-  if(result == cURL::Result::SUCCESS) {
-    // Make sure response data isnt empty
-    if(!data.empty()) {
-      //processData(data, headers);
-      parseCameras(data);
-    } else {
-      // Error out and exit if empty string returned  
-//      std::cerr << Output::Colors::RED << "[cURL]: Retrieved data string empty.\n" << Output::Colors::END;
-      return false;
-    }
-  } else {
-    switch(result) {
-      case cURL::Result::TIMEOUT:
-//        std::cerr << Output::Colors::RED << "[cURL] Timed out retrieving data from remote stream. Retrying in 60 seconds..." << Output::Colors::END;
-        break;
-      default:
-//        std::cerr << Output::Colors::RED << "[cURL] Critical error retrieiving data from remote stream. Terminating program." << Output::Colors::END;
-        return false;
-    }
-  }
 
-  return true;
-}
-
-bool parseCameras(const std::string& data) {
-  auto parsedData = JSON::parseData(data);
-  for(const auto& camera : parsedData) {
-    if(!camera.isObject()) {
-//      std::cerr << Output::Colors::RED << "[NYSDOT] Failed parsing camera (is the JSON valid?)\n" << Output::Colors::END;
-      return false; // Or do we want to continue here?
-    } else
-      processCamera(camera);
-  }
-//  std::cout << Output::Colors::GREEN << "\n[JSON] Successfully parsed root tree.\n" << Output::Colors::END;
-  return true;
-}
+  // Parse each camera object as soon as it has been received
+  std::vector<Camera> cameras;
+  std::size_t skipped{ 0 };
+  JSON::ArraySplitter splitter;
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Value parsedCamera;
+  std::string errs;
+  auto onCamera = [&](std::string_view text) {
+    if(!reader->parse(text.data(), text.data() + text.size(), &parsedCamera, &errs) || !parsedCamera.isObject()) {
+      skipped++;
+      return;
+    }
+    if(auto camera = processCamera(parsedCamera, DataSource::NYSDOT))
+      cameras.push_back(std::move(*camera));
+  };
+  cURL::Result result = cURL::streamData(url, curlHandle, [&](std::string_view chunk){ splitter.feed(chunk, onCamera); });
 
-bool processCamera(const Json::Value& parsedCamera) {
-  if(!parsedCamera.isMember("ID")) {
-//    std::cerr << Output::Colors::RED << "[JSON] Error: No 'ID' member present in JSON event.\n" << Output::Colors::END;
+  // Keep the previous cameras unless a whole list arrived, error pages would otherwise empty the store
+  if(result != cURL::Result::SUCCESS)
+    return false;
+  long httpStatus{ 0 };
+  curl_easy_getinfo(curlHandle.get(), CURLINFO_RESPONSE_CODE, &httpStatus);
+  if(httpStatus < 200 || httpStatus >= 300) {
+    Output::logger.log(Output::LogLevel::WARN, "CAMERAS", "Camera list request failed with HTTP " + std::to_string(httpStatus));
     return false;
   }
-
-  // Extract key/ID from the event
-  std::string key = parsedCamera["ID"].asString();
-  Location location = { parsedCamera["Latitude"].asDouble(), parsedCamera["Longitude"].asDouble() };
-
-  if(!NYSDOT::regionSyracuse.contains(location)) // TODO: Add more regions
+  if(!splitter.complete()) {
+    Output::logger.log(Output::LogLevel::WARN, "CAMERAS", "Camera list was not a complete JSON array");
     return false;
-
-  auto [camera, inserted] = mapCameras.try_emplace(key, parsedCamera);
-  if(!inserted) {
-    if(parsedCamera["Disabled"].asBool() == camera->second.isOnline()) {
-      return false;
-    }
-    camera->second = parsedCamera;
-//    std::cout << Output::Colors::MAGENTA << "[JSON] Updated event: " << key << Output::Colors::END << '\n';
   }
+  if(skipped) {
+    std::string msg = "Skipped " + std::to_string(skipped) + " unparseable cameras";
+    Output::logger.log(Output::LogLevel::WARN, "JSON", msg);
+  }
+  std::string msg = "Loaded " + std::to_string(cameras.size()) + " cameras";
+  Output::logger.log(Output::LogLevel::INFO, "CAMERAS", msg);
+  cameraStore.replace(DataSource::NYSDOT, std::move(cameras));
   return true;
 }
 
+// Build a camera from its parsed object, keeping only cameras inside one of our markets
+std::optional<Camera> processCamera(const Json::Value& parsedCamera, DataSource source) {
+  if(!parsedCamera.isMember("ID"))
+    return std::nullopt;
+  Camera camera(parsedCamera, source);
+  if(camera.getRegion() == Region::UNKNOWN)
+    return std::nullopt;
+  return camera;
+}
+
 // Camera constructors
-Camera::Camera(const Json::Value& parsedCamera)
-: dataSource{ currentSource }
+Camera::Camera(const Json::Value& parsedCamera, DataSource source)
+: dataSource{ source }
 {
   if(parsedCamera.isMember("ID"))
     ID = parsedCamera["ID"].asString();
@@ -1104,9 +1673,10 @@ Camera::Camera(const Json::Value& parsedCamera)
     roadwayName = parsedCamera["RoadwayName"].asString();
   if(parsedCamera.isMember("DirectionOfTravel"))
     direction = parsedCamera["DirectionOfTravel"].asString();
-  if(parsedCamera.isMember("Latitude") && parsedCamera.isMember("Latitude"))
+  if(parsedCamera.isMember("Latitude") && parsedCamera.isMember("Longitude"))
     location = { parsedCamera["Latitude"].asDouble(), parsedCamera["Longitude"].asDouble() }; 
-  
+  // Cameras only report coordinates, so place them by market
+  region = NYSDOT::getRegion(location);
 }
 
 Camera::Camera(Camera&& other) noexcept
@@ -1142,6 +1712,25 @@ Camera& Camera::operator=(Camera&& other) noexcept
   return *this;
 }
 
+// Serialize a camera as a JSON object
+void Camera::serializeToJSON(JSON::Writer& writer) const {
+  writer.beginObject();
+  writer.key("id").value(ID);
+  writer.key("name").value(description);
+  writer.key("image").nullable(imageURL);
+  writer.key("video").nullable(videoURL);
+  writer.key("online").value(online);
+  writer.key("roadway").nullable(roadwayName);
+  writer.key("direction").value(direction);
+  writer.key("source").nullable(sourceName(dataSource));
+  writer.key("region").nullable(regionName(region));
+  writer.key("location").beginObject();
+  writer.key("lat").value(location.latitude);
+  writer.key("long").value(location.longitude);
+  writer.endObject();
+  writer.endObject();
+}
+
 // Output Operators
 
 std::ostream& operator<<(std::ostream& out, const Region& region) {
@@ -1205,12 +1794,12 @@ std::ostream& operator<<(std::ostream& out, const DataSource& dataSource) {
 }
 
 std::ostream &operator<<(std::ostream &out, const Event &event){
-  std::tm timeReported = Time::toLocalPrint(event.timeReported);
-  std::tm timeUpdated = Time::toLocalPrint(event.timeUpdated);
+  std::tm timeReported = Time::toLocalPrint(Time::fromEpoch(event.summary.timeReported));
+  std::tm timeUpdated = Time::toLocalPrint(Time::fromEpoch(event.summary.timeUpdated));
 
-  out << '\n' << Output::Colors::CYAN << event.region << " (" << event.dataSource << ")  |  " << event.ID << "  |  " << event.status << Output::Colors::END << '\n'
+  out << '\n' << Output::Colors::CYAN << event.summary.region << " (" << event.summary.dataSource << ")  |  " << event.ID << "  |  " << event.getStatusText() << Output::Colors::END << '\n'
       << event.title << '\n'
-      << event.mainStreet << "(" << event.direction << ") at " << event.crossStreet << "  |  " << event.location << '\n'
+      << event.mainStreet << "(" << event.getDirectionText() << ") at " << event.crossStreet << "  |  " << event.location << '\n'
       << event.description << '\n'
       << event.URL << '\n'
       << "Reported: " << std::put_time(&timeReported, "%T - %F") << "  |  Updated: " << std::put_time(&timeUpdated, "%T - %F")
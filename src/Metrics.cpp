@@ -0,0 +1,279 @@
+#include "Metrics.h"
+#include "Traffic.h"
+#include "EventStore.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+
+namespace {
+
+// Families in definition order, only added to during static initialization
+std::vector<const Family*>& registry() {
+  static std::vector<const Family*> families;
+  return families;
+}
+
+// Shortest text that reads back as the same double, as Prometheus expects
+std::string formatNumber(double number) {
+  if(std::isinf(number))
+    return number > 0 ? "+Inf" : "-Inf";
+  if(std::isnan(number))
+    return "NaN";
+  char digits[32];
+  auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), number);
+  return std::string(digits, end);
+}
+
+std::vector<std::string> sourceLabels() {
+  std::vector<std::string> names;
+  for(std::size_t i = 0; i < Traffic::SOURCE_COUNT; i++) {
+    std::string name = Traffic::toString(static_cast<Traffic::DataSource>(i));
+    names.push_back(name.empty() ? "unknown" : name);
+  }
+  return names;
+}
+
+std::vector<std::string> changeLabels() {
+  std::vector<std::string> names;
+  for(std::size_t i = 0; i < Traffic::CHANGE_TYPE_COUNT; i++)
+    names.emplace_back(Traffic::toString(static_cast<Traffic::ChangeType>(i)));
+  return names;
+}
+
+// Indexed by FetchStatus, RequestPath and RequestFilter
+const std::vector<std::string> FETCH_STATUS_NAMES{ "2xx", "3xx", "4xx", "5xx", "failed" };
+const std::vector<std::string> REQUEST_PATH_NAMES{
+  "/events", "/events.geojson", "/events/changes", "/events/history", "/events/stream", "/events/socket",
+  "/incidents", "/cameras", "/status", "/metrics", "other"
+};
+const std::vector<std::string> REQUEST_FILTER_NAMES{ "none", "region", "source", "region_source", "bbox", "radius", "other" };
+
+} // namespace
+
+// Threads take the next slot the first time they record anything
+std::size_t slotIndex() {
+  static std::atomic<std::size_t> next{ 0 };
+  thread_local std::size_t slot = next.fetch_add(1, std::memory_order_relaxed) % METRIC_SLOTS;
+  return slot;
+}
+
+std::vector<std::string> labelSets(std::string_view name, const std::vector<std::string>& values) {
+  std::vector<std::string> sets;
+  for(const std::string& value : values)
+    sets.push_back(std::string(name) + "=\"" + value + '"');
+  return sets;
+}
+
+std::vector<std::string> labelProduct(std::string_view firstName, const std::vector<std::string>& first,
+                                      std::string_view secondName, const std::vector<std::string>& second) {
+  std::vector<std::string> sets;
+  for(const std::string& outer : labelSets(firstName, first))
+    for(const std::string& inner : labelSets(secondName, second))
+      sets.push_back(outer + ',' + inner);
+  return sets;
+}
+
+Family::Family(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets)
+  : name(std::move(familyName)), help(std::move(familyHelp)), labels(std::move(labelSets)) {
+  registry().push_back(this);
+}
+
+void Family::writeHeader(std::string& out, std::string_view type) const {
+  out += "# HELP " + name + ' ' + help + '\n';
+  out += "# TYPE " + name + ' ';
+  out += type;
+  out += '\n';
+}
+
+void Family::writeSample(std::string& out, std::string_view suffix, std::size_t series, std::string_view extra, std::string_view value) const {
+  out += name;
+  out += suffix;
+  const std::string& set = labels[series];
+  if(!set.empty() || !extra.empty()) {
+    out += '{';
+    out += set;
+    if(!set.empty() && !extra.empty())
+      out += ',';
+    out += extra;
+    out += '}';
+  }
+  out += ' ';
+  out += value;
+  out += '\n';
+}
+
+Counter::Counter(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets)
+  : Family(std::move(familyName), std::move(familyHelp), std::move(labelSets)),
+    slots(std::make_unique<Slot[]>(labels.size() * METRIC_SLOTS)) {}
+
+std::uint64_t Counter::value(std::size_t series) const {
+  std::uint64_t total{ 0 };
+  for(std::size_t i = 0; i < METRIC_SLOTS; i++)
+    total += slots[series * METRIC_SLOTS + i].value.load(std::memory_order_relaxed);
+  return total;
+}
+
+void Counter::write(std::string& out) const {
+  writeHeader(out, "counter");
+  for(std::size_t series = 0; series < labels.size(); series++)
+    writeSample(out, "", series, "", std::to_string(value(series)));
+}
+
+Gauge::Gauge(std::string familyName, std::string familyHelp, std::vector<std::string> labelSets)
+  : Family(std::move(familyName), std::move(familyHelp), std::move(labelSets)),
+    values(std::make_unique<std::atomic<std::int64_t>[]>(labels.size())) {}
+
+void Gauge::write(std::string& out) const {
+  writeHeader(out, "gauge");
+  for(std::size_t series = 0; series < labels.size(); series++)
+    writeSample(out, "", series, "", std::to_string(values[series].load(std::memory_order_relaxed)));
+}
+
+Sampled::Sampled(std::string familyName, std::string familyHelp, std::string sampleType, std::function<double()> reader)
+  : Family(std::move(familyName), std::move(familyHelp), { "" }), type(std::move(sampleType)), read(std::move(reader)) {}
+
+void Sampled::write(std::string& out) const {
+  writeHeader(out, type);
+  writeSample(out, "", 0, "", formatNumber(read()));
+}
+
+Histogram::Histogram(std::string familyName, std::string familyHelp, const std::vector<double>& boundSeconds, std::vector<std::string> labelSets)
+  : Family(std::move(familyName), std::move(familyHelp), std::move(labelSets)),
+    slots(std::make_unique<Slot[]>(labels.size() * METRIC_SLOTS)) {
+  for(double bound : boundSeconds)
+    bounds.push_back(static_cast<std::int64_t>(std::llround(bound * 1e9)));
+}
+
+void Histogram::observe(std::size_t series, std::chrono::steady_clock::duration elapsed) {
+  std::int64_t nanos = std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0);
+  // First bucket whose bound holds the duration, the overflow bucket otherwise
+  std::size_t bucket = static_cast<std::size_t>(std::lower_bound(bounds.begin(), bounds.end(), nanos) - bounds.begin());
+  Slot& slot = slots[series * METRIC_SLOTS + slotIndex()];
+  slot.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  slot.sumNanos.fetch_add(static_cast<std::uint64_t>(nanos), std::memory_order_relaxed);
+}
+
+void Histogram::write(std::string& out) const {
+  writeHeader(out, "histogram");
+  for(std::size_t series = 0; series < labels.size(); series++) {
+    // Sum the thread slots first, buckets are written cumulatively
+    std::array<std::uint64_t, MAX_HISTOGRAM_BUCKETS + 1> counts{};
+    std::uint64_t sumNanos{ 0 };
+    for(std::size_t i = 0; i < METRIC_SLOTS; i++) {
+      const Slot& slot = slots[series * METRIC_SLOTS + i];
+      for(std::size_t bucket = 0; bucket <= bounds.size(); bucket++)
+        counts[bucket] += slot.buckets[bucket].load(std::memory_order_relaxed);
+      sumNanos += slot.sumNanos.load(std::memory_order_relaxed);
+    }
+    std::uint64_t cumulative{ 0 };
+    for(std::size_t bucket = 0; bucket <= bounds.size(); bucket++)
+      cumulative += counts[bucket];
+    if(cumulative == 0 && labels[series].size() != 0)
+      continue;
+    cumulative = 0;
+    for(std::size_t bucket = 0; bucket <= bounds.size(); bucket++) {
+      cumulative += counts[bucket];
+      std::string le = bucket < bounds.size() ? formatNumber(static_cast<double>(bounds[bucket]) / 1e9) : "+Inf";
+      writeSample(out, "_bucket", series, "le=\"" + le + '"', std::to_string(cumulative));
+    }
+    writeSample(out, "_sum", series, "", formatNumber(static_cast<double>(sumNanos) / 1e9));
+    writeSample(out, "_count", series, "", std::to_string(cumulative));
+  }
+}
+
+void TimedMutex::lock() {
+  auto start = std::chrono::steady_clock::now();
+  mutex.lock();
+  acquired = std::chrono::steady_clock::now();
+  waitTime.observe(0, acquired - start);
+}
+
+bool TimedMutex::try_lock() {
+  if(!mutex.try_lock())
+    return false;
+  acquired = std::chrono::steady_clock::now();
+  waitTime.observe(0, std::chrono::steady_clock::duration::zero());
+  return true;
+}
+
+// Read the hold time before unlocking, the next owner overwrites the acquisition time
+void TimedMutex::unlock() {
+  auto held = std::chrono::steady_clock::now() - acquired;
+  mutex.unlock();
+  holdTime.observe(0, held);
+}
+
+std::string serializeToPrometheus() {
+  std::string out;
+  out.reserve(16 * 1024);
+  for(const Family* family : registry())
+    family->write(out);
+  return out;
+}
+
+FetchStatus toFetchStatus(long httpStatus) {
+  if(httpStatus >= 200 && httpStatus < 300)
+    return FetchStatus::Success;
+  if(httpStatus >= 300 && httpStatus < 400)
+    return FetchStatus::Redirect;
+  if(httpStatus >= 400 && httpStatus < 500)
+    return FetchStatus::ClientError;
+  if(httpStatus >= 500 && httpStatus < 600)
+    return FetchStatus::ServerError;
+  return FetchStatus::Failed;
+}
+
+RequestPath toRequestPath(std::string_view path) {
+  if(path == "/events/")
+    return RequestPath::Events;
+  for(std::size_t i = 0; i < static_cast<std::size_t>(RequestPath::Other); i++)
+    if(path == REQUEST_PATH_NAMES[i])
+      return static_cast<RequestPath>(i);
+  return RequestPath::Other;
+}
+
+RequestFilter toRequestFilter(const std::vector<std::pair<std::string, std::string>>& queryParams) {
+  bool region{ false }, source{ false }, other{ false };
+  for(const auto& [key, value] : queryParams) {
+    if(key == "bbox")
+      return RequestFilter::BoundingBox;
+    if(key == "lat" || key == "lon" || key == "radius")
+      return RequestFilter::Radius;
+    if(key == "region")
+      region = true;
+    else if(key == "source")
+      source = true;
+    else
+      other = true;
+  }
+  if(region && source)
+    return RequestFilter::RegionSource;
+  if(region)
+    return RequestFilter::Region;
+  if(source)
+    return RequestFilter::Source;
+  return other ? RequestFilter::Other : RequestFilter::None;
+}
+
+Histogram fetchSeconds{ "traffic_fetch_duration_seconds", "Time to download a source's event feed.", FETCH_BUCKETS, labelSets("source", sourceLabels()) };
+Counter fetchBytes{ "traffic_fetch_bytes_total", "Bytes downloaded from each source's event feed.", labelSets("source", sourceLabels()) };
+Counter fetchResponses{ "traffic_fetch_responses_total", "Event feed requests by HTTP status class.",
+                        labelProduct("source", sourceLabels(), "status", FETCH_STATUS_NAMES) };
+Histogram parseSeconds{ "traffic_parse_duration_seconds", "Time to parse a source's feed and store its events.", PARSE_BUCKETS, labelSets("source", sourceLabels()) };
+Counter eventChanges{ "traffic_event_changes_total", "Events inserted, updated and deleted in the store.", labelSets("type", changeLabels()) };
+Gauge cycleEventChanges{ "traffic_cycle_event_changes", "Events inserted, updated and deleted by the last fetch cycle.", labelSets("type", changeLabels()) };
+Histogram eventsLockWait{ "traffic_events_lock_wait_seconds", "Time spent waiting to lock the event store.", LOCK_BUCKETS };
+Histogram eventsLockHold{ "traffic_events_lock_hold_seconds", "Time the event store was held locked.", LOCK_BUCKETS };
+Histogram requestSeconds{ "traffic_api_request_duration_seconds", "Time spent handling API requests by endpoint and filter.", REQUEST_BUCKETS,
+                          labelProduct("path", REQUEST_PATH_NAMES, "filter", REQUEST_FILTER_NAMES) };
+
+} // namespace Metrics
@@ -4,6 +4,7 @@
 #include <string>
 #include <ios>
 #include <iostream>
+#include <unistd.h>
 
 namespace Output {
 Logger logger("log.txt");
@@ -47,6 +48,15 @@ void clearConsole() {
   std::cout << "\033[2J\033[1;1H";
 }
 
+// Read the resident page count from procfs
+std::size_t residentMemoryKB() {
+  std::ifstream statm("/proc/self/statm");
+  std::size_t totalPages{ 0 }, residentPages{ 0 };
+  if(!(statm >> totalPages >> residentPages))
+    return 0;
+  return residentPages * (static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) / 1024);
+}
+
 Logger::Logger(const std::string& fileName) 
 : path{fileName}
 {
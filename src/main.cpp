@@ -2,13 +2,26 @@
 #include "Output.h"
 #include "RestAPI.h"
 #include "Traffic.h"
+#include "EventStore.h"
+#include "Database.h"
+#include "History.h"
+#include "CameraStore.h"
+#include "Incidents.h"
+#include "Snapshot.h"
+#include "StringPool.h"
+#include "EventStream.h"
+#include "Metrics.h"
+#include "NYSDOT.h"
+#include <array>
 #include <atomic>
 #include <ctime>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <utility>
 
 // Atomic flag for program end
 std::atomic<bool> programEnd(false);
@@ -20,14 +33,42 @@ void waitForEnter() {
   std::cin.get();
 }
 
+// Publish the changes made since the last call, from the running change totals
+void recordCycleChanges(std::array<std::uint64_t, Traffic::CHANGE_TYPE_COUNT>& totals) {
+  for(std::size_t type = 0; type < Traffic::CHANGE_TYPE_COUNT; type++) {
+    std::uint64_t total = Metrics::eventChanges.value(type);
+    Metrics::cycleEventChanges.set(type, static_cast<std::int64_t>(total - totals[type]));
+    totals[type] = total;
+  }
+}
+
 // Get all traffic data
 void getTrafficData() {
   int interval_seconds = 5;
   int sleep_seconds = 60;
   int sleep_intervals = sleep_seconds / interval_seconds;
+  // Start from the totals after the snapshot was loaded, so restored events don't count as the first cycle's inserts
+  std::array<std::uint64_t, Traffic::CHANGE_TYPE_COUNT> changeTotals{};
+  recordCycleChanges(changeTotals);
   while(!programEnd) {
     Traffic::fetchEvents();
     Traffic::clearEvents();
+    recordCycleChanges(changeTotals);
+    // Regroup the cycle's changed events into incidents
+    {
+      std::lock_guard<Metrics::TimedMutex> lock(Traffic::eventsMutex);
+      Traffic::incidentIndex.update(Traffic::mapEvents);
+    }
+    // Push the cycle's changes to streaming clients
+    RestAPI::eventStream.publish(Traffic::mapEvents);
+    // Checkpoint the refreshed store for the next warm start
+    Traffic::saveSnapshot(Traffic::mapEvents, Traffic::SNAPSHOT_PATH);
+    // Hand the cycle's changes to the database writer
+    Traffic::eventDatabase.capture(Traffic::mapEvents);
+    // Record memory usage for the cycle
+    std::string memMsg = "Resident memory: " + std::to_string(Output::residentMemoryKB()) + " kB ("
+                       + std::to_string(Intern::size()) + " interned strings, " + std::to_string(Intern::bytes()) + " bytes)";
+    Output::logger.log(Output::LogLevel::INFO, "MEMORY", memMsg);
     Output::logger.flush();
     Output::mtlLog.flush();
     Output::ottLog.flush();
@@ -37,6 +78,20 @@ void getTrafficData() {
   }
 }
 
+// Get camera data
+// Camera lists change rarely, so they are refreshed on a much longer schedule than events
+void getCameraData() {
+  int interval_seconds = 5;
+  int sleep_seconds = 15 * 60;
+  int sleep_intervals = sleep_seconds / interval_seconds;
+  while(!programEnd) {
+    Traffic::fetchCameras();
+    // Sleep in intervals
+    for(int i = 0; i < sleep_intervals && !programEnd; i++)
+      std::this_thread::sleep_for(std::chrono::seconds(interval_seconds));
+  }
+}
+
 // Cleanup function to join the thread
 void cleanupThread(std::thread& t) {
   if (t.joinable()) { 
@@ -180,6 +235,30 @@ void debugConsole() {
 
 int main() {
 
+  // Retain replaced and cleared events in the history log
+  if(Traffic::eventHistory.open(Traffic::HISTORY_PATH, Traffic::HISTORY_CAPACITY)) {
+    Traffic::eventHistory.start();
+    Traffic::mapEvents.setRetireHandler([](Traffic::Event&& event, Traffic::ChangeType reason){
+      Traffic::eventHistory.retire(std::move(event), reason);
+    });
+  }
+
+  // Persist events into the relational schema in the background
+  if(Traffic::eventDatabase.open(Traffic::DATABASE_PATH))
+    Traffic::eventDatabase.start();
+
+  // Link events to their nearest cameras as they are stored
+  Traffic::mapEvents.setStoreHandler([](Traffic::Event& event){ Traffic::linkCameras(event); });
+
+  // Serve the last known events until the first fetch refreshes them
+  Traffic::loadSnapshot(Traffic::mapEvents, Traffic::SNAPSHOT_PATH);
+
+  // Start writing to streaming clients
+  RestAPI::eventStream.start();
+
+  // Source the API key before the fetch threads start, they only read it
+  Traffic::NYSDOT::getEnv();
+
   // Spin up the data processing thread
   std::thread dataThread(getTrafficData);
   std::stringstream dataID;
@@ -187,6 +266,13 @@ int main() {
   std::string dataMsg = "Started thread: " + dataID.str();
   Output::logger.log(Output::LogLevel::INFO, "START", dataMsg);
   
+  // Spin up the camera thread
+  std::thread cameraThread(getCameraData);
+  std::stringstream cameraID;
+  cameraID << cameraThread.get_id();
+  std::string cameraMsg = "Started thread: " + cameraID.str();
+  Output::logger.log(Output::LogLevel::INFO, "START", cameraMsg);
+
   // Spin up the api thread
   std::thread apiThread(RestAPI::startApiServer);
   std::stringstream apiID;
@@ -194,10 +280,6 @@ int main() {
   std::string apiMsg = "Started thread: " + apiID.str();
   Output::logger.log(Output::LogLevel::INFO, "START", apiMsg);
 
-  // Wait a bit for services to start
-  std::cout << "Staring services...\n";
-  std::this_thread::sleep_for(std::chrono::seconds(5));
-
   // Main application logic here
   // Start the debug console for runtime testing
   debugConsole();
@@ -205,6 +287,13 @@ int main() {
   // Clean up the data thread
   cleanupThread(apiThread);
   cleanupThread(dataThread);
+  cleanupThread(cameraThread);
+  // Close any open event streams
+  RestAPI::eventStream.stop();
+  // Flush any retired events still queued for the history log
+  Traffic::eventHistory.stop();
+  // Flush any batches still queued for the database
+  Traffic::eventDatabase.stop();
 
   return 0;
 }